@@ -0,0 +1,78 @@
+/**
+ * @file SEGGER_RTT.h
+ * @brief Host stand-in for SEGGER RTT — counts bytes instead of moving them.
+ *
+ * Provides the handful of RTT calls the recorder core makes, and the control
+ * block that VA_RTT_ZERO_COPY writes through.  Writes are copied into the
+ * configured up-buffer (so the copy cost is real) and summed in
+ * va_mock_rtt_bytes for the benchmark's bytes/event column.
+ * va_mock_rtt_read() plays the probe: it consumes everything written since
+ * the last call, and va_mock_rtt_host_write() queues bytes in the
+ * down-buffer for SEGGER_RTT_Read() (VA_REMOTE_CONTROL).
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_MOCK_SEGGER_RTT_H
+#define VA_MOCK_SEGGER_RTT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEGGER_RTT_MODE_NO_BLOCK_SKIP      0u
+#define SEGGER_RTT_MODE_NO_BLOCK_TRIM      1u
+#define SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL 2u
+
+#define SEGGER_RTT_MAX_NUM_UP_BUFFERS   1
+#define SEGGER_RTT_MAX_NUM_DOWN_BUFFERS 1
+#define SEGGER_RTT_LOCK()   {
+#define SEGGER_RTT_UNLOCK() }
+
+typedef struct
+{
+    const char        *sName;
+    char              *pBuffer;
+    unsigned           SizeOfBuffer;
+    unsigned           WrOff;
+    volatile unsigned  RdOff;
+    unsigned           Flags;
+} SEGGER_RTT_BUFFER_UP;
+
+typedef struct
+{
+    const char        *sName;
+    char              *pBuffer;
+    unsigned           SizeOfBuffer;
+    volatile unsigned  WrOff;
+    unsigned           RdOff;
+    unsigned           Flags;
+} SEGGER_RTT_BUFFER_DOWN;
+
+typedef struct
+{
+    SEGGER_RTT_BUFFER_UP   aUp[SEGGER_RTT_MAX_NUM_UP_BUFFERS];
+    SEGGER_RTT_BUFFER_DOWN aDown[SEGGER_RTT_MAX_NUM_DOWN_BUFFERS];
+} SEGGER_RTT_CB;
+
+extern SEGGER_RTT_CB _SEGGER_RTT;
+extern uint64_t va_mock_rtt_bytes;
+
+void     va_mock_rtt_read(void);
+unsigned va_mock_rtt_host_write(const void *pBuffer, unsigned NumBytes);
+
+void     SEGGER_RTT_Init(void);
+int      SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer,
+                                   unsigned BufferSize, unsigned Flags);
+unsigned SEGGER_RTT_Write(unsigned BufferIndex, const void *pBuffer, unsigned NumBytes);
+int      SEGGER_RTT_ConfigDownBuffer(unsigned BufferIndex, const char *sName, void *pBuffer,
+                                     unsigned BufferSize, unsigned Flags);
+unsigned SEGGER_RTT_Read(unsigned BufferIndex, void *pBuffer, unsigned BufferSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_MOCK_SEGGER_RTT_H */
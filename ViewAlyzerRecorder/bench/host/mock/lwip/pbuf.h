@@ -0,0 +1,56 @@
+/**
+ * @file pbuf.h
+ * @brief Host stand-in for lwIP's pbuf API (lwip/pbuf.h).
+ *
+ * Only the single-buffer PBUF_RAM case the recorder uses: pbuf_alloc()
+ * returns one heap block with room for the protocol headers in front of
+ * the payload, like lwIP's own PBUF_RAM pbufs.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_MOCK_LWIP_PBUF_H
+#define VA_MOCK_LWIP_PBUF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef int8_t err_t;
+
+#define ERR_OK  0
+#define ERR_MEM -1
+
+typedef enum
+{
+    PBUF_TRANSPORT = 54, /* link + IP + UDP header room, as lwIP reserves */
+    PBUF_RAW = 0
+} pbuf_layer;
+
+typedef enum
+{
+    PBUF_RAM,
+    PBUF_POOL
+} pbuf_type;
+
+struct pbuf
+{
+    struct pbuf *next;
+    void        *payload;
+    u16_t        tot_len;
+    u16_t        len;
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+void         pbuf_realloc(struct pbuf *p, u16_t size);
+u8_t         pbuf_free(struct pbuf *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_MOCK_LWIP_PBUF_H */
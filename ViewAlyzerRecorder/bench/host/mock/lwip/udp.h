@@ -0,0 +1,45 @@
+/**
+ * @file udp.h
+ * @brief Host stand-in for lwIP's raw UDP API (lwip/udp.h).
+ *
+ * udp_send() plays the network: it sums every datagram's payload in
+ * va_mock_udp_bytes for the benchmark's bytes/event column, and counts the
+ * datagrams in va_mock_udp_datagrams.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_MOCK_LWIP_UDP_H
+#define VA_MOCK_LWIP_UDP_H
+
+#include "lwip/pbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    uint32_t addr;
+} ip_addr_t;
+
+struct udp_pcb
+{
+    ip_addr_t remote_ip;
+    u16_t     remote_port;
+};
+
+typedef void (*udp_recv_fn)(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr,
+                            u16_t port);
+
+extern uint64_t va_mock_udp_bytes;
+extern uint64_t va_mock_udp_datagrams;
+
+err_t udp_send(struct udp_pcb *pcb, struct pbuf *p);
+void  udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_MOCK_LWIP_UDP_H */
@@ -0,0 +1,140 @@
+/**
+ * @file main.h
+ * @brief Host stand-in for the board header — mock CMSIS core registers.
+ *
+ * ViewAlyzer.h includes "main.h" to reach the device's CMSIS definitions.
+ * This version provides just the pieces the recorder core touches, backed
+ * by plain variables, so ViewAlyzer.c builds unmodified on a desktop host:
+ *
+ *   - DWT->CYCCNT     simulated cycle counter, advanced by the benchmark
+ *   - ITM->PORT[]     stimulus port that reports FIFO space, unless a test
+ *                     marks it busy; tests can also capture what is written
+ *   - CoreDebug       DEMCR only
+ *   - PRIMASK         __get/__set_PRIMASK, __disable_irq / __enable_irq
+ *   - LDREX/STREX     single-threaded exclusive monitor; a test can run a
+ *                     simulated interrupt inside the LDREX/STREX window
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_MOCK_MAIN_H
+#define VA_MOCK_MAIN_H
+
+#include <stdint.h>
+
+/* Pose as a Cortex-M4 so the core takes its DWT/ITM (ARMv7-M) code paths. */
+#if !defined(__ARM_ARCH_7M__) && !defined(__ARM_ARCH_7EM__)
+#define __ARM_ARCH_7EM__ 1
+#endif
+#ifndef __ARM_ARCH
+#define __ARM_ARCH 7
+#endif
+
+/* The host tests build with 1: the ITM port and the exclusive monitor get
+ * test controls, which the benchmarks would otherwise pay for on every
+ * access. */
+#ifndef VA_MOCK_TEST_HOOKS
+#define VA_MOCK_TEST_HOOKS 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CYCCNT;
+} VA_Mock_DWT_Type;
+
+typedef union
+{
+    volatile uint8_t  u8;
+    volatile uint16_t u16;
+    volatile uint32_t u32;
+} VA_Mock_ITM_Port_Type;
+
+typedef struct
+{
+    VA_Mock_ITM_Port_Type PORT[32];
+    volatile uint32_t     TER;
+    volatile uint32_t     TCR;
+    volatile uint32_t     LAR;
+} VA_Mock_ITM_Type;
+
+typedef struct
+{
+    volatile uint32_t DEMCR;
+} VA_Mock_CoreDebug_Type;
+
+extern VA_Mock_DWT_Type       va_mock_dwt;
+extern VA_Mock_CoreDebug_Type va_mock_core_debug;
+extern uint32_t               va_mock_primask;
+
+/* Every ITM access goes through here so the stimulus port reads as ready
+ * again after the recorder writes a data word into it. */
+VA_Mock_ITM_Type *va_mock_itm(void);
+
+#if VA_MOCK_TEST_HOOKS
+/* Test controls for VA_ITM_PORT: after @p after more writes, the next
+ * @p reads ITM accesses see a full FIFO; writes are appended to @p buf
+ * (NULL stops capturing). */
+void     va_mock_itm_busy(uint32_t after, uint32_t reads);
+void     va_mock_itm_capture(uint8_t *buf, uint32_t size);
+uint32_t va_mock_itm_captured(void);
+#endif
+
+#define DWT       (&va_mock_dwt)
+#define ITM       (va_mock_itm())
+#define CoreDebug (&va_mock_core_debug)
+
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0)
+#define ITM_TCR_ITMENA_Msk         (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+static inline uint32_t __get_PRIMASK(void) { return va_mock_primask; }
+static inline void __set_PRIMASK(uint32_t primask) { va_mock_primask = primask; }
+static inline void __disable_irq(void) { va_mock_primask = 1u; }
+static inline void __enable_irq(void) { va_mock_primask = 0u; }
+static inline uint32_t __get_IPSR(void) { return 0u; }
+
+static inline void __DMB(void) { __sync_synchronize(); }
+
+#if VA_MOCK_TEST_HOOKS
+/* Called by every STREX before it stores.  A non-zero return means an
+ * interrupt ran in the window, which clears the exclusive monitor the way
+ * exception entry and return do, so the STREX fails. */
+extern int (*va_mock_strex_irq)(void);
+extern uint32_t va_mock_exclusive;
+
+static inline uint32_t __LDREXW(volatile uint32_t *addr)
+{
+    va_mock_exclusive = 1u;
+    return *addr;
+}
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)
+{
+    if (va_mock_strex_irq != 0 && va_mock_strex_irq())
+        va_mock_exclusive = 0u;
+    if (va_mock_exclusive == 0u)
+        return 1u;
+    va_mock_exclusive = 0u;
+    *addr = value;
+    return 0u;
+}
+static inline void __CLREX(void) { va_mock_exclusive = 0u; }
+#else
+static inline uint32_t __LDREXW(volatile uint32_t *addr) { return *addr; }
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr)
+{
+    *addr = value;
+    return 0u;
+}
+static inline void __CLREX(void) {}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_MOCK_MAIN_H */
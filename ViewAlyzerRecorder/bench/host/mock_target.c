@@ -0,0 +1,342 @@
+/**
+ * @file mock_target.c
+ * @brief Host stand-ins for the target side of the recorder.
+ *
+ * Backs the registers declared in mock/main.h (with the test controls for
+ * the ITM port), implements the RTT and lwIP mocks from mock/SEGGER_RTT.h
+ * and mock/lwip/, and provides a minimal RTOS adapter so the task, stack
+ * and sync-object paths of ViewAlyzer.c can run without a kernel.  Task
+ * handles are VA_MockTask_t pointers with a painted stack, so stack capture
+ * costs a real watermark scan like uxTaskGetStackHighWaterMark() does.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#include "mock_target.h"
+#include "SEGGER_RTT.h"
+#include "lwip/udp.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ================================================================
+ *  CMSIS registers
+ * ================================================================ */
+
+VA_Mock_DWT_Type       va_mock_dwt;
+VA_Mock_CoreDebug_Type va_mock_core_debug;
+uint32_t               va_mock_primask;
+
+#if VA_MOCK_TEST_HOOKS
+int      (*va_mock_strex_irq)(void);
+uint32_t va_mock_exclusive;
+
+/* A ready port holds this pattern between accesses, so a write shows up as
+ * a change on the next access: all four bytes for a word, only the low
+ * byte for a byte.  Tests must not write 0xA5 bytes or ...A5A5A5 words. */
+#define VA_MOCK_ITM_READY 0xA5A5A5A5u
+
+static VA_Mock_ITM_Type s_mock_itm;
+static struct
+{
+    uint32_t ready;    /* writes left before the port turns busy */
+    uint32_t busy;     /* accesses left that read as a full FIFO */
+    uint32_t preset;   /* what the port held after the last access */
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t len;
+} s_mock_itm_port;
+
+static void _mock_itm_put(uint8_t b)
+{
+    if (s_mock_itm_port.len < s_mock_itm_port.size)
+        s_mock_itm_port.buf[s_mock_itm_port.len] = b;
+    s_mock_itm_port.len++;
+}
+
+/* The recorder polls the port before every write, so the port only turns
+ * busy between a write and the next poll, as a real FIFO fills up. */
+static void _mock_itm_collect(void)
+{
+    uint32_t v = s_mock_itm.PORT[VA_ITM_PORT].u32;
+    if (v == s_mock_itm_port.preset)
+        return;
+    if (s_mock_itm_port.ready != 0u)
+        s_mock_itm_port.ready--;
+    if (s_mock_itm_port.buf == NULL)
+        return;
+    if ((v & 0xFFFFFF00u) == (s_mock_itm_port.preset & 0xFFFFFF00u))
+    {
+        _mock_itm_put((uint8_t)v);
+        return;
+    }
+    for (uint32_t i = 0; i < 4u; i++)
+        _mock_itm_put((uint8_t)(v >> (8u * i)));
+}
+
+VA_Mock_ITM_Type *va_mock_itm(void)
+{
+    _mock_itm_collect();
+    if (s_mock_itm_port.ready == 0u && s_mock_itm_port.busy != 0u)
+    {
+        s_mock_itm_port.busy--;
+        s_mock_itm_port.preset = 0u;
+    }
+    else
+    {
+        s_mock_itm_port.preset = VA_MOCK_ITM_READY; /* FIFO has room */
+    }
+    s_mock_itm.PORT[VA_ITM_PORT].u32 = s_mock_itm_port.preset;
+    return &s_mock_itm;
+}
+
+void va_mock_itm_busy(uint32_t after, uint32_t reads)
+{
+    _mock_itm_collect();
+    s_mock_itm_port.preset = s_mock_itm.PORT[VA_ITM_PORT].u32;
+    s_mock_itm_port.ready = after;
+    s_mock_itm_port.busy = reads;
+}
+
+void va_mock_itm_capture(uint8_t *buf, uint32_t size)
+{
+    _mock_itm_collect();
+    s_mock_itm_port.buf = buf;
+    s_mock_itm_port.size = size;
+    s_mock_itm_port.len = 0;
+    s_mock_itm_port.preset = s_mock_itm.PORT[VA_ITM_PORT].u32;
+}
+
+/* Bytes written since va_mock_itm_capture(), including the last access */
+uint32_t va_mock_itm_captured(void)
+{
+    _mock_itm_collect();
+    s_mock_itm_port.preset = s_mock_itm.PORT[VA_ITM_PORT].u32;
+    return s_mock_itm_port.len;
+}
+
+#else
+
+static VA_Mock_ITM_Type s_mock_itm;
+
+VA_Mock_ITM_Type *va_mock_itm(void)
+{
+    s_mock_itm.PORT[VA_ITM_PORT].u32 = 1u; /* FIFO has room */
+    return &s_mock_itm;
+}
+
+#endif /* VA_MOCK_TEST_HOOKS */
+
+/* ================================================================
+ *  RTT
+ * ================================================================ */
+
+static char s_rtt_buf[4096]; /* until the recorder configures its own */
+
+SEGGER_RTT_CB _SEGGER_RTT = {{{"Terminal", s_rtt_buf, sizeof(s_rtt_buf), 0, 0, 0}}, {{NULL, NULL, 0, 0, 0, 0}}};
+uint64_t va_mock_rtt_bytes;
+
+void SEGGER_RTT_Init(void)
+{
+    _SEGGER_RTT.aUp[0].WrOff = 0;
+    _SEGGER_RTT.aUp[0].RdOff = 0;
+    _SEGGER_RTT.aDown[0].WrOff = 0;
+    _SEGGER_RTT.aDown[0].RdOff = 0;
+}
+
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char *sName, void *pBuffer,
+                              unsigned BufferSize, unsigned Flags)
+{
+    (void)BufferIndex;
+    SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[0];
+    up->sName = sName;
+    if (pBuffer != NULL && BufferSize > 0)
+    {
+        up->pBuffer = (char *)pBuffer;
+        up->SizeOfBuffer = BufferSize;
+    }
+    up->WrOff = 0;
+    up->RdOff = 0;
+    up->Flags = Flags;
+    return 0;
+}
+
+/* Never blocks: the probe is assumed to keep up */
+unsigned SEGGER_RTT_Write(unsigned BufferIndex, const void *pBuffer, unsigned NumBytes)
+{
+    (void)BufferIndex;
+    SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[0];
+    const uint8_t *src = (const uint8_t *)pBuffer;
+    unsigned left = NumBytes;
+    while (left > 0)
+    {
+        unsigned room = up->SizeOfBuffer - up->WrOff;
+        unsigned n = (left < room) ? left : room;
+        memcpy(&up->pBuffer[up->WrOff], src, n);
+        up->WrOff = (up->WrOff + n) % up->SizeOfBuffer;
+        src += n;
+        left -= n;
+    }
+    up->RdOff = up->WrOff;
+    va_mock_rtt_bytes += NumBytes;
+    return NumBytes;
+}
+
+int SEGGER_RTT_ConfigDownBuffer(unsigned BufferIndex, const char *sName, void *pBuffer,
+                                unsigned BufferSize, unsigned Flags)
+{
+    (void)BufferIndex;
+    SEGGER_RTT_BUFFER_DOWN *down = &_SEGGER_RTT.aDown[0];
+    down->sName = sName;
+    down->pBuffer = (char *)pBuffer;
+    down->SizeOfBuffer = BufferSize;
+    down->WrOff = 0;
+    down->RdOff = 0;
+    down->Flags = Flags;
+    return 0;
+}
+
+unsigned SEGGER_RTT_Read(unsigned BufferIndex, void *pBuffer, unsigned BufferSize)
+{
+    (void)BufferIndex;
+    SEGGER_RTT_BUFFER_DOWN *down = &_SEGGER_RTT.aDown[0];
+    uint8_t *dst = (uint8_t *)pBuffer;
+    unsigned n = 0;
+    while (n < BufferSize && down->RdOff != down->WrOff)
+    {
+        dst[n++] = (uint8_t)down->pBuffer[down->RdOff];
+        down->RdOff = (down->RdOff + 1u) % down->SizeOfBuffer;
+    }
+    return n;
+}
+
+/* The probe's side of the down-buffer: queue what fits, return the count */
+unsigned va_mock_rtt_host_write(const void *pBuffer, unsigned NumBytes)
+{
+    SEGGER_RTT_BUFFER_DOWN *down = &_SEGGER_RTT.aDown[0];
+    const uint8_t *src = (const uint8_t *)pBuffer;
+    unsigned n = 0;
+    if (down->SizeOfBuffer == 0)
+        return 0;
+    while (n < NumBytes && (down->WrOff + 1u) % down->SizeOfBuffer != down->RdOff)
+    {
+        down->pBuffer[down->WrOff] = (char)src[n++];
+        down->WrOff = (down->WrOff + 1u) % down->SizeOfBuffer;
+    }
+    return n;
+}
+
+/* Consume what was written into the buffer directly (VA_RTT_ZERO_COPY) */
+void va_mock_rtt_read(void)
+{
+    SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[0];
+    unsigned wr = up->WrOff;
+    unsigned rd = up->RdOff;
+    va_mock_rtt_bytes += (wr >= rd) ? (wr - rd) : (up->SizeOfBuffer - rd + wr);
+    up->RdOff = wr;
+}
+
+/* ================================================================
+ *  lwIP
+ * ================================================================ */
+
+uint64_t va_mock_udp_bytes;
+uint64_t va_mock_udp_datagrams;
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    (void)type;
+    struct pbuf *p = malloc(sizeof(struct pbuf) + (size_t)layer + length);
+    if (p == NULL)
+        return NULL;
+    p->next = NULL;
+    p->payload = (uint8_t *)(p + 1) + layer;
+    p->tot_len = length;
+    p->len = length;
+    return p;
+}
+
+void pbuf_realloc(struct pbuf *p, u16_t size)
+{
+    if (size < p->len)
+        p->len = p->tot_len = size;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    free(p);
+    return 1;
+}
+
+err_t udp_send(struct udp_pcb *pcb, struct pbuf *p)
+{
+    volatile uint8_t last = ((const uint8_t *)p->payload)[p->len - 1u]; /* touch the datagram */
+    (void)pcb;
+    (void)last;
+    va_mock_udp_bytes += p->tot_len;
+    va_mock_udp_datagrams++;
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg)
+{
+    (void)pcb;
+    (void)recv;
+    (void)recv_arg;
+}
+
+/* ================================================================
+ *  RTOS adapter
+ * ================================================================ */
+
+#if VA_HAS_RTOS
+
+#define VA_MOCK_STACK_FILL 0xA5A5A5A5u
+
+void va_mock_task_init(VA_MockTask_t *task, uint32_t usedWords)
+{
+    if (usedWords > VA_MOCK_STACK_WORDS)
+        usedWords = VA_MOCK_STACK_WORDS;
+    for (uint32_t i = 0; i < VA_MOCK_STACK_WORDS; i++)
+        task->stack[i] = (i < VA_MOCK_STACK_WORDS - usedWords) ? VA_MOCK_STACK_FILL : i;
+}
+
+VA_QueueObjectType_t va_adapter_get_queue_object_type(void *handle)
+{
+    return ((VA_MockObject_t *)handle)->type;
+}
+
+/* Used words, found by counting untouched fill words from the bottom of the
+ * (descending) stack — the walk FreeRTOS does in prvTaskCheckFreeStackSpace(). */
+uint32_t va_adapter_calculate_stack_usage(void *taskHandle)
+{
+    const VA_MockTask_t *task = (const VA_MockTask_t *)taskHandle;
+    uint32_t free_words = 0;
+    while (free_words < VA_MOCK_STACK_WORDS && task->stack[free_words] == VA_MOCK_STACK_FILL)
+        free_words++;
+    return VA_MOCK_STACK_WORDS - free_words;
+}
+
+uint32_t va_adapter_get_total_stack_size(void *taskHandle)
+{
+    (void)taskHandle;
+    return VA_MOCK_STACK_WORDS;
+}
+
+bool va_adapter_get_stack_region(void *taskHandle, VA_StackRegion_t *region)
+{
+    const VA_MockTask_t *task = (const VA_MockTask_t *)taskHandle;
+    region->base = task->stack;
+    region->words = VA_MOCK_STACK_WORDS;
+    region->fill = VA_MOCK_STACK_FILL;
+    region->unit_shift = 0;
+    return true;
+}
+
+void va_adapter_check_mutex_contention(void *queueObject, uint8_t queue_va_id)
+{
+    (void)queueObject;
+    (void)queue_va_id;
+}
+
+#endif /* VA_HAS_RTOS */
@@ -0,0 +1,40 @@
+/**
+ * @file mock_target.h
+ * @brief Host stand-ins for the target side of the recorder (see mock_target.c).
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_MOCK_TARGET_H
+#define VA_MOCK_TARGET_H
+
+#include "ViewAlyzer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VA_MOCK_STACK_WORDS 256u
+
+/** Stand-in for a TCB: the handle passed to the task hooks. */
+typedef struct
+{
+    uint32_t stack[VA_MOCK_STACK_WORDS];
+} VA_MockTask_t;
+
+/** Stand-in for a queue / semaphore / mutex handle. */
+typedef struct
+{
+    VA_QueueObjectType_t type;
+} VA_MockObject_t;
+
+#if VA_HAS_RTOS
+/** Paint the stack and mark the top @p usedWords as touched. */
+void va_mock_task_init(VA_MockTask_t *task, uint32_t usedWords);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_MOCK_TARGET_H */
@@ -0,0 +1,400 @@
+/**
+ * @file va_bench.c
+ * @brief Host microbenchmark for the recorder core — ns/event and bytes/event.
+ *
+ * Runs every public logging API and RTOS hook of the real ViewAlyzer.c
+ * (built against mock/main.h) in a tight loop and reports the average host
+ * time and transport bytes per call.  The simulated CYCCNT is advanced by a
+ * fixed number of cycles before each call, so periodic work that depends
+ * on target time (auto setup bundles, CYCCNT rollover) is amortised into
+ * the numbers at a realistic rate.
+ *
+ * Host nanoseconds are not target cycles: use the numbers to compare
+ * builds and catch regressions, not as a cycle budget.
+ *
+ * Usage:
+ *   va_bench [--csv] [events_per_api] [cycles_between_events]
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "ViewAlyzer.h"
+#include "mock_target.h"
+#if VA_TRANSPORT_IS_JLINK
+#include "SEGGER_RTT.h"
+#elif VA_TRANSPORT_IS_LWIP_UDP
+#include "lwip/udp.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef VA_BENCH_NAME
+#define VA_BENCH_NAME "va_bench"
+#endif
+
+#define VA_BENCH_CPU_HZ         100000000u /* simulated core clock */
+#define VA_BENCH_DEFAULT_EVENTS 200000u
+#define VA_BENCH_DEFAULT_CYCLES 1000u      /* 100k events/s at 100 MHz */
+#define VA_BENCH_BLOCK_SAMPLES  64u
+
+/* ================================================================
+ *  Transport byte counting
+ * ================================================================ */
+
+#if VA_TRANSPORT_IS_CUSTOM
+static uint64_t s_custom_bytes;
+
+static void _bench_send(const uint8_t *data, uint32_t length)
+{
+    volatile uint8_t last = data[length - 1u]; /* touch the frame so the copy isn't dead */
+    (void)last;
+    s_custom_bytes += length;
+}
+#elif VA_TRANSPORT_IS_UART_DMA
+/* Simulated DMA engine with an infinitely fast UART: every transfer
+ * completes inside the start call, so the numbers show the recorder's
+ * cost and not the link's. */
+static uint64_t s_dma_bytes;
+static uint64_t s_dma_transfers;
+
+static void _bench_dma_start(const uint8_t *data, uint32_t length)
+{
+    volatile uint8_t last = data[length - 1u];
+    (void)last;
+    s_dma_bytes += length;
+    s_dma_transfers++;
+    VA_UartDmaTxComplete();
+}
+#endif
+
+/* Returns false when the transport can't be observed (ITM port writes). */
+static bool _bench_bytes(uint64_t *bytes)
+{
+#if VA_TRANSPORT_IS_JLINK
+    va_mock_rtt_read();
+    *bytes = va_mock_rtt_bytes;
+    return true;
+#elif VA_TRANSPORT_IS_CUSTOM
+    *bytes = s_custom_bytes;
+    return true;
+#elif VA_TRANSPORT_IS_UART_DMA
+    *bytes = s_dma_bytes;
+    return true;
+#elif VA_TRANSPORT_IS_LWIP_UDP
+    *bytes = va_mock_udp_bytes;
+    return true;
+#else
+    *bytes = 0;
+    return false;
+#endif
+}
+
+/* ================================================================
+ *  Benchmark cases
+ * ================================================================ */
+
+#if VA_HAS_RTOS
+static VA_MockTask_t   s_tasks[4];
+static VA_MockObject_t s_queue = {VA_OBJECT_TYPE_QUEUE};
+static VA_MockObject_t s_mutex = {VA_OBJECT_TYPE_MUTEX};
+static VA_MockObject_t s_heap  = {VA_OBJECT_TYPE_HEAP};
+#endif
+static int16_t s_block[VA_BENCH_BLOCK_SAMPLES];
+#if VA_SINKS
+/* Post-mortem RAM sink next to the transport: every packet is also
+ * COBS-framed into it, which the timings include */
+static uint8_t      s_ram_sink_buf[8192];
+static VA_RamSink_t s_ram_sink;
+#endif
+
+static void _case_nop(uint32_t i) { (void)i; }
+static void _case_trace(uint32_t i) { VA_LogTrace(1, (int32_t)i); }
+static void _case_trace_float(uint32_t i) { VA_LogTraceFloat(2, (float)i * 0.5f); }
+static void _case_trace_block(uint32_t i)
+{
+    (void)i;
+    VA_LogTraceBlock(3, VA_SAMPLE_INT16, s_block, VA_BENCH_BLOCK_SAMPLES, 10000u);
+}
+static void _case_string(uint32_t i)
+{
+    (void)i;
+    VA_LogString(4, "motor: setpoint reached, hold");
+}
+static void _case_logf(uint32_t i) { VA_Logf(5, "adc ch%u = %d mV", (unsigned)(i & 7u), (int)i); }
+static void _case_toggle(uint32_t i) { VA_LogToggle(6, (i & 1u) != 0); }
+static void _case_event(uint32_t i) { VA_LogEvent(1, (i & 1u) ? USER_EVENT_END : USER_EVENT_START); }
+static void _case_isr_start(uint32_t i)
+{
+    (void)i;
+    VA_LogISRStart(VA_ISR_ID_SYSTICK);
+}
+static void _case_isr_end(uint32_t i)
+{
+    (void)i;
+    VA_LogISREnd(VA_ISR_ID_SYSTICK);
+}
+static void _case_counter(uint32_t i) { VA_LogCounter(7, i); }
+static void _case_gpio(uint32_t i) { VA_LogGPIO(1, (i & 1u) != 0); }
+static void _case_heap(uint32_t i) { VA_LogHeap(1, 1024u + (i & 255u)); }
+
+#if VA_REMOTE_CONTROL
+/* One COBS-framed VA_CMD_SET_ID per call, for an id nothing logs */
+static const uint8_t s_cmd_frame[] = {0x05, VA_CMD_SET_ID, VA_CLASS_USER, 9, 1, 0x00};
+static void _case_command(uint32_t i)
+{
+    (void)i;
+#if VA_TRANSPORT_IS_JLINK
+    (void)va_mock_rtt_host_write(s_cmd_frame, sizeof(s_cmd_frame));
+    VA_PollCommands();
+#else
+    VA_ReceiveCommandBytes(s_cmd_frame, sizeof(s_cmd_frame));
+#endif
+}
+#endif
+
+#if VA_HAS_RTOS
+static void _case_switch_in(uint32_t i) { va_taskswitchedin(&s_tasks[i & 3u]); }
+static void _case_switch_out(uint32_t i) { va_taskswitchedout(&s_tasks[i & 3u]); }
+static void _case_notify_give(uint32_t i) { va_logtasknotifygive(&s_tasks[0], &s_tasks[1], i); }
+static void _case_notify_take(uint32_t i) { va_logtasknotifytake(&s_tasks[1], i); }
+static void _case_queue_give(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectGive(&s_queue, 0);
+}
+static void _case_queue_take(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectTake(&s_queue, 10);
+}
+static void _case_mutex_take(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectTake(&s_mutex, 10);
+}
+static void _case_blocking(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectBlocking(&s_mutex);
+}
+static void _case_heap_alloc(uint32_t i) { va_logHeapAlloc(&s_heap, 64u + (i & 63u)); }
+static void _case_heap_free(uint32_t i) { va_logHeapFree(&s_heap, 64u + (i & 63u)); }
+static void _case_sleep_enter(uint32_t i)
+{
+    (void)i;
+    va_logSleepEnter(&s_tasks[2]);
+}
+static void _case_sleep_exit(uint32_t i)
+{
+    (void)i;
+    va_logSleepExit(&s_tasks[2]);
+}
+#endif /* VA_HAS_RTOS */
+
+typedef struct
+{
+    const char *name;
+    void (*run)(uint32_t i);
+} VA_BenchCase_t;
+
+static const VA_BenchCase_t s_cases[] = {
+    {"VA_LogTrace", _case_trace},
+    {"VA_LogTraceFloat", _case_trace_float},
+    {"VA_LogTraceBlock(64 x int16)", _case_trace_block},
+    {"VA_LogString(29 chars)", _case_string},
+    {"VA_Logf(2 args)", _case_logf},
+    {"VA_LogToggle", _case_toggle},
+    {"VA_LogEvent", _case_event},
+    {"VA_LogISRStart", _case_isr_start},
+    {"VA_LogISREnd", _case_isr_end},
+    {"VA_LogCounter", _case_counter},
+    {"VA_LogGPIO", _case_gpio},
+    {"VA_LogHeap", _case_heap},
+#if VA_REMOTE_CONTROL
+    {"VA_PollCommands(SET_ID)", _case_command},
+#endif
+#if VA_HAS_RTOS
+    {"va_taskswitchedin", _case_switch_in},
+    {"va_taskswitchedout", _case_switch_out},
+    {"va_logtasknotifygive", _case_notify_give},
+    {"va_logtasknotifytake", _case_notify_take},
+    {"va_logQueueObjectGive", _case_queue_give},
+    {"va_logQueueObjectTake", _case_queue_take},
+    {"va_logQueueObjectTake(mutex)", _case_mutex_take},
+    {"va_logQueueObjectBlocking", _case_blocking},
+    {"va_logHeapAlloc", _case_heap_alloc},
+    {"va_logHeapFree", _case_heap_free},
+    {"va_logSleepEnter", _case_sleep_enter},
+    {"va_logSleepExit", _case_sleep_exit},
+#endif
+};
+
+/* ================================================================
+ *  Runner
+ * ================================================================ */
+
+static uint64_t _now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Average ns and transport bytes per call of @p fn over @p events calls. */
+static void _bench_run(void (*fn)(uint32_t), uint32_t events, uint32_t cycles,
+                       double *ns, double *bytes)
+{
+    void (*volatile call)(uint32_t) = fn; /* keep every call an indirect call, baseline included */
+    uint64_t b0, b1;
+    _bench_bytes(&b0);
+
+    uint64_t t0 = _now_ns();
+    for (uint32_t i = 0; i < events; i++)
+    {
+        va_mock_dwt.CYCCNT += cycles;
+        call(i);
+#if VA_TRANSPORT_IS_JLINK && VA_RTT_ZERO_COPY
+        va_mock_rtt_read(); /* the probe keeps up */
+#endif
+#if VA_USE_RING_BUFFER
+        if ((i & 63u) == 63u)
+            (void)VA_Drain(0);
+#endif
+    }
+#if VA_USE_RING_BUFFER
+    (void)VA_Drain(0);
+#endif
+    uint64_t t1 = _now_ns();
+
+    _bench_bytes(&b1);
+    *ns = (double)(t1 - t0) / events;
+    *bytes = (double)(b1 - b0) / events;
+}
+
+static void _bench_setup(void)
+{
+#if VA_TRANSPORT_IS_CUSTOM
+    VA_RegisterTransportSend(_bench_send);
+#elif VA_TRANSPORT_IS_UART_DMA
+    VA_RegisterUartDmaStart(_bench_dma_start);
+#elif VA_TRANSPORT_IS_LWIP_UDP
+    static struct udp_pcb pcb;
+    VA_RegisterLwipUdp(&pcb);
+#endif
+    VA_Init(VA_BENCH_CPU_HZ);
+#if VA_SINKS
+    VA_RamSinkInit(&s_ram_sink, s_ram_sink_buf, sizeof(s_ram_sink_buf));
+    const VA_Sink_t ram = {VA_RamSinkWrite, &s_ram_sink, VA_ALL_CLASSES, 0, 0};
+    (void)VA_AddSink(&ram);
+#endif
+
+    for (uint32_t i = 0; i < VA_BENCH_BLOCK_SAMPLES; i++)
+        s_block[i] = (int16_t)(i * 100u);
+
+    VA_RegisterUserTrace(1, "LoopTime", VA_USER_TYPE_GRAPH);
+    VA_RegisterUserTrace(2, "Voltage", VA_USER_TYPE_GRAPH);
+    VA_RegisterUserTrace(3, "ADC", VA_USER_TYPE_GRAPH);
+    VA_RegisterUserTrace(6, "Alive", VA_USER_TYPE_TOGGLE);
+    VA_RegisterUserTrace(7, "Frames", VA_USER_TYPE_COUNTER);
+    VA_RegisterUserEvent(1, "process_sample");
+    VA_RegisterGPIO(1, "LED");
+    VA_RegisterHeap(1, "pool", 4096u);
+
+#if VA_HAS_RTOS
+    static const char *const names[4] = {"Control", "Comms", "Logger", "Idle"};
+    for (uint32_t t = 0; t < 4u; t++)
+    {
+        va_mock_task_init(&s_tasks[t], 40u + 20u * t);
+        va_taskcreated(&s_tasks[t], names[t]);
+    }
+    va_logQueueObjectCreate(&s_queue, "rxQueue");
+    va_logQueueObjectCreate(&s_mutex, "busMutex");
+    va_logQueueObjectCreate(&s_heap, "heap");
+#endif
+
+#if VA_USE_RING_BUFFER
+    (void)VA_Drain(0);
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    bool csv = false;
+    uint32_t events = VA_BENCH_DEFAULT_EVENTS;
+    uint32_t cycles = VA_BENCH_DEFAULT_CYCLES;
+    int pos = 0;
+    for (int a = 1; a < argc; a++)
+    {
+        if (strcmp(argv[a], "--csv") == 0)
+            csv = true;
+        else if (pos++ == 0)
+            events = (uint32_t)strtoul(argv[a], NULL, 0);
+        else
+            cycles = (uint32_t)strtoul(argv[a], NULL, 0);
+    }
+    if (events == 0)
+        events = 1;
+
+    _bench_setup();
+
+    double base_ns, base_bytes;
+    _bench_run(_case_nop, events, cycles, &base_ns, &base_bytes);
+
+    uint64_t unused;
+    bool have_bytes = _bench_bytes(&unused);
+
+    if (csv)
+    {
+        printf("config,api,ns_per_event,bytes_per_event\n");
+    }
+    else
+    {
+        printf("%s: transport %s, stack capture %s, auto setup %u ms\n", VA_BENCH_NAME,
+               VA_TRANSPORT_IS_ITM ? "ITM" : (VA_TRANSPORT_IS_JLINK ? "RTT" : (VA_TRANSPORT_IS_UART_DMA ? "UART DMA (COBS)" : (VA_TRANSPORT_IS_LWIP_UDP ? "lwIP UDP (COBS)" : "custom (COBS)"))),
+               VA_CAPTURE_STACK_USAGE ? "on" : "off", (unsigned)VA_AUTO_SETUP_INTERVAL_MS);
+        printf("%u events per API, %u simulated cycles apart at %u MHz\n\n", (unsigned)events,
+               (unsigned)cycles, (unsigned)(VA_BENCH_CPU_HZ / 1000000u));
+        printf("%-32s %10s %12s\n", "API", "ns/event", "bytes/event");
+    }
+
+    for (size_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); c++)
+    {
+        double ns, bytes;
+        _bench_run(s_cases[c].run, events, cycles, &ns, &bytes);
+        ns -= base_ns;
+        if (ns < 0.0)
+            ns = 0.0;
+
+        if (csv)
+        {
+            if (have_bytes)
+                printf("%s,%s,%.1f,%.2f\n", VA_BENCH_NAME, s_cases[c].name, ns, bytes);
+            else
+                printf("%s,%s,%.1f,\n", VA_BENCH_NAME, s_cases[c].name, ns);
+        }
+        else if (have_bytes)
+        {
+            printf("%-32s %10.1f %12.2f\n", s_cases[c].name, ns, bytes);
+        }
+        else
+        {
+            printf("%-32s %10.1f %12s\n", s_cases[c].name, ns, "-");
+        }
+    }
+
+#if VA_TRANSPORT_IS_UART_DMA
+    if (!csv)
+        printf("\n%llu DMA transfers, %.1f bytes each\n", (unsigned long long)s_dma_transfers,
+               s_dma_transfers ? (double)s_dma_bytes / (double)s_dma_transfers : 0.0);
+#elif VA_TRANSPORT_IS_LWIP_UDP
+    if (!csv)
+        printf("\n%llu datagrams, %.1f bytes each\n", (unsigned long long)va_mock_udp_datagrams,
+               va_mock_udp_datagrams ? (double)va_mock_udp_bytes / (double)va_mock_udp_datagrams : 0.0);
+#endif
+    return 0;
+}
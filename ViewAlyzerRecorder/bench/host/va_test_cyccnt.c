@@ -0,0 +1,111 @@
+/**
+ * @file va_test_cyccnt.c
+ * @brief Host stress test: the 64-bit CYCCNT extension never goes backwards.
+ *
+ * Steps the simulated DWT->CYCCNT across many 2^32 wraps, always by less
+ * than the half period _va_extend_cyccnt() must be sampled at.  Whenever
+ * the extension publishes a new epoch, the mock STREX (mock/main.h) may
+ * first run a simulated "ISR" that moves the counter on and takes its own
+ * timestamps, nesting up to VA_TEST_MAX_NESTING deep, so the store of the
+ * preempted context fails and it has to retry.  The test fails if
+ *
+ *   - a timestamp is smaller than one returned before it, or
+ *   - a timestamp lies outside the true 64-bit count at call entry and
+ *     return.
+ *
+ * Usage:
+ *   va_test_cyccnt [samples]
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#include "ViewAlyzer.h"
+#include "VA_Internal.h"
+#include "mock_target.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define VA_TEST_SAMPLES     2000000u
+#define VA_TEST_MAX_STEP    (1u << 30)   /* between samples, < 2^31 */
+#define VA_TEST_MAX_ISR     (1u << 26)   /* cycles an ISR runs before it samples */
+#define VA_TEST_MAX_NESTING 3u
+
+static uint64_t s_now;   /* true 64-bit cycle count */
+static uint64_t s_last;  /* last timestamp returned, in return order */
+static uint32_t s_seed = 12345u;
+static uint32_t s_depth;
+static uint32_t s_preemptions;
+static int      s_failed;
+
+static uint32_t _rand(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return s_seed >> 1;
+}
+
+static void _advance(uint32_t cycles)
+{
+    s_now += cycles;
+    va_mock_dwt.CYCCNT = (uint32_t)s_now;
+}
+
+static void _sample(void)
+{
+    uint64_t entry = s_now;
+    uint64_t ts = _va_get_timestamp();
+    if (ts < s_last || ts < entry || ts > s_now)
+    {
+        if (!s_failed)
+            fprintf(stderr, "timestamp %llu after %llu, true count %llu..%llu (depth %u)\n",
+                    (unsigned long long)ts, (unsigned long long)s_last,
+                    (unsigned long long)entry, (unsigned long long)s_now, (unsigned)s_depth);
+        s_failed = 1;
+    }
+    s_last = ts;
+}
+
+/* A simulated interrupt between LDREX and STREX on every other epoch
+ * update; it may be preempted again the same way. */
+static int _strex_irq(void)
+{
+    if (s_depth >= VA_TEST_MAX_NESTING || (_rand() & 1u) == 0u)
+        return 0;
+    s_depth++;
+    s_preemptions++;
+    _advance(_rand() % VA_TEST_MAX_ISR);
+    _sample();
+    s_depth--;
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t samples = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : VA_TEST_SAMPLES;
+
+    va_mock_dwt.CYCCNT = 0;
+    VA_Init(100000000u);
+    s_now = va_mock_dwt.CYCCNT;
+    va_mock_strex_irq = _strex_irq;
+
+    for (uint32_t i = 0; i < samples && !s_failed; i++)
+    {
+        /* Mostly large steps to cross wraps quickly, some small ones to
+         * sample close around the half-period edges */
+        _advance(((_rand() & 3u) == 0u) ? _rand() % 4096u : _rand() % VA_TEST_MAX_STEP);
+        _sample();
+    }
+    va_mock_strex_irq = NULL;
+
+    uint64_t wraps = s_now >> 32;
+    if (!s_failed && (wraps < 1000u || s_preemptions == 0u))
+    {
+        fprintf(stderr, "only %llu wraps and %u preemptions\n", (unsigned long long)wraps,
+                (unsigned)s_preemptions);
+        s_failed = 1;
+    }
+
+    printf("%s: %u samples, %llu wraps, %u preempted epoch updates\n", s_failed ? "FAIL" : "PASS",
+           (unsigned)samples, (unsigned long long)wraps, (unsigned)s_preemptions);
+    return s_failed ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file va_test_itm_loss.c
+ * @brief Host test: non-blocking ITM drops never break the delta chain.
+ *
+ * Built with VA_ITM_NONBLOCKING=1 and VA_COMPACT_TIMESTAMPS=1 against the
+ * mock ITM port (mock/main.h), which is made busy for a few accesses before
+ * or in the middle of a packet.  The captured port stream is decoded the
+ * way the host does it, and the test fails if
+ *
+ *   - a delta-encoded event follows a sync marker or loss report without a
+ *     time anchor in between,
+ *   - a decoded event time differs from the CYCCNT it was logged at, or
+ *   - an event is neither decoded nor counted by VA_GetLostEvents().
+ *
+ * Usage:
+ *   va_test_itm_loss [rounds]
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#include "ViewAlyzer.h"
+#include "mock_target.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !VA_TRANSPORT_IS_ITM || !VA_ITM_NONBLOCKING || !VA_COMPACT_TIMESTAMPS
+#error "va_test_itm_loss needs ARM_ITM with VA_ITM_NONBLOCKING=1 and VA_COMPACT_TIMESTAMPS=1"
+#endif
+
+#define VA_TEST_CYCLES    1000u   /* CYCCNT step between events */
+#define VA_TEST_ROUNDS    20000u
+#define VA_TEST_STREAM    (1024u * 1024u)
+
+static const uint8_t s_sync[] = {0x56, 0x41, 0x5A, 0x01, 0x53, 0x59, 0x4E, 0x43, 0x30, 0x31, 0xAA, 0x55};
+
+static uint8_t  s_stream[VA_TEST_STREAM];
+static uint32_t s_logged;
+static uint32_t s_decoded;
+static uint32_t s_seed = 12345u;
+
+static uint32_t _rand(void)
+{
+    s_seed = s_seed * 1103515245u + 12345u;
+    return s_seed >> 16;
+}
+
+/* Event n is logged at CYCCNT _event_time(n) with value n */
+static uint64_t _event_time(uint32_t n)
+{
+    return 0x10000u + (uint64_t)n * VA_TEST_CYCLES;
+}
+
+static void _log_event(uint32_t after, uint32_t busy)
+{
+    va_mock_dwt.CYCCNT = (uint32_t)_event_time(s_logged);
+    va_mock_itm_busy(after, busy);
+    VA_LogTrace(1, (int32_t)s_logged);
+    s_logged++;
+}
+
+/* The marker itself can be cut after any word, so its first word is
+ * enough to end the packet in front of it */
+static uint32_t _find_sync(const uint8_t *s, uint32_t from, uint32_t len)
+{
+    for (uint32_t i = from; i + 4u <= len; i++)
+    {
+        if (memcmp(&s[i], s_sync, 4u) == 0)
+            return i;
+    }
+    return len;
+}
+
+static uint64_t _get_u64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (uint32_t i = 0; i < 8u; i++)
+        v |= (uint64_t)p[i] << (8u * i);
+    return v;
+}
+
+/* Decode the captured stream.  A packet that runs into the next sync marker
+ * was cut; the marker (and the loss report after it) resets the chain. */
+static int _decode(const uint8_t *s, uint32_t len)
+{
+    bool     have_base = false;
+    uint64_t base = 0;
+    uint32_t i = 0;
+
+    while (i < len)
+    {
+        uint32_t sync = _find_sync(s, i, len);
+        if (sync == i)
+        {
+            bool whole = i + sizeof(s_sync) <= len && memcmp(&s[i], s_sync, sizeof(s_sync)) == 0;
+            have_base = false;
+            i += whole ? (uint32_t)sizeof(s_sync) : 4u;
+            continue;
+        }
+
+        uint32_t need;
+        switch (s[i])
+        {
+        case VA_SETUP_TIME_ANCHOR:
+            need = 10u;
+            break;
+        case VA_EVENT_LOSS:
+            need = (i + 18u < sync) ? 19u + 2u * s[i + 18u] : 19u;
+            break;
+        case VA_EVENT_USER_TRACE:
+            need = 3u;
+            while (i + need - 1u < sync && (s[i + need - 1u] & 0x80u))
+                need++;
+            need += 4u;
+            break;
+        default:
+            if (sync == len)
+            {
+                fprintf(stderr, "unknown byte 0x%02X at %u\n", s[i], (unsigned)i);
+                return 1;
+            }
+            i = sync;   /* tail of a cut packet */
+            continue;
+        }
+        if (i + need > sync)
+        {
+            if (sync == len)
+            {
+                fprintf(stderr, "packet 0x%02X at %u cut without a sync marker\n", s[i], (unsigned)i);
+                return 1;
+            }
+            i = sync;
+            continue;
+        }
+
+        if (s[i] == VA_SETUP_TIME_ANCHOR)
+        {
+            base = _get_u64(&s[i + 2u]);
+            have_base = true;
+        }
+        else if (s[i] == VA_EVENT_LOSS)
+        {
+            have_base = false;
+        }
+        else
+        {
+            if (!have_base)
+            {
+                fprintf(stderr, "delta at %u without a time anchor\n", (unsigned)i);
+                return 1;
+            }
+            uint64_t delta = 0;
+            uint32_t k = i + 2u;
+            for (uint32_t shift = 0;; shift += 7u)
+            {
+                delta |= (uint64_t)(s[k] & 0x7Fu) << shift;
+                if ((s[k++] & 0x80u) == 0u)
+                    break;
+            }
+            uint32_t n = (uint32_t)s[k] | ((uint32_t)s[k + 1u] << 8) |
+                         ((uint32_t)s[k + 2u] << 16) | ((uint32_t)s[k + 3u] << 24);
+            base += delta;
+            if (n >= s_logged || base != _event_time(n))
+            {
+                fprintf(stderr, "event %u decoded at %llu, logged at %llu\n", (unsigned)n,
+                        (unsigned long long)base, (unsigned long long)_event_time(n));
+                return 1;
+            }
+            s_decoded++;
+        }
+        i += need;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : VA_TEST_ROUNDS;
+
+    VA_Init(100000000u);
+    VA_RegisterUserTrace(1, "Value", VA_USER_TYPE_GRAPH);
+
+    /* An event dropped on a busy port (the setup packets before it are not
+     * decoded).  The next event re-sends the anchor, whose loss report meets
+     * a busy port once more: the event must go down with its anchor even
+     * though its own loss report would get through. */
+    _log_event(0, 1);
+    va_mock_itm_capture(s_stream, sizeof(s_stream));
+    _log_event(0, 1);
+    _log_event(0, 3);
+    _log_event(0, 0);
+
+    /* Drops and cut packets at random points.  VA_ITM_SPIN_LIMIT is small,
+     * so a stall of a few reads cuts a packet. */
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        uint32_t busy = ((_rand() & 3u) == 0u) ? _rand() % 8u : 0u;
+        _log_event(_rand() % 12u, busy);
+    }
+
+    /* The last loss report goes out in front of one more clean event */
+    _log_event(0, 0);
+
+    uint32_t len = va_mock_itm_captured();
+    if (len > sizeof(s_stream))
+    {
+        fprintf(stderr, "stream overflow\n");
+        return 1;
+    }
+    int failed = _decode(s_stream, len);
+
+    uint32_t lost = VA_GetLostEvents(VA_CLASS_USER);
+    if (!failed && s_decoded + lost != s_logged)
+    {
+        fprintf(stderr, "%u events logged, %u decoded, %u reported lost\n", (unsigned)s_logged,
+                (unsigned)s_decoded, (unsigned)lost);
+        failed = 1;
+    }
+
+    printf("%s: %u events, %u decoded, %u lost, %u system packets lost\n",
+           failed ? "FAIL" : "PASS", (unsigned)s_logged, (unsigned)s_decoded, (unsigned)lost,
+           (unsigned)VA_GetLostEvents(VA_CLASS_SYSTEM));
+    return failed ? 1 : 0;
+}
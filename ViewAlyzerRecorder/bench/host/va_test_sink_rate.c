@@ -0,0 +1,105 @@
+/**
+ * @file va_test_sink_rate.c
+ * @brief Host test: a rate-limited sink gets its full bytesPerSecond.
+ *
+ * Built with VA_SINKS=1 and a ring buffer on the custom transport.  Events
+ * are logged well above the sink's budget and VA_Drain() runs on a period
+ * whose refill is not a whole number of bytes, so every refill rounds.
+ * Once the first burst is spent, the sink must receive bytesPerSecond to
+ * within one packet over VA_TEST_SECONDS of simulated time; the rounded-off
+ * fractions must not be lost.
+ *
+ * Usage:
+ *   va_test_sink_rate
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#include "ViewAlyzer.h"
+#include "mock_target.h"
+
+#include <stdio.h>
+
+#if !VA_SINKS || !VA_USE_RING_BUFFER
+#error "va_test_sink_rate needs VA_SINKS=1 and VA_USE_RING_BUFFER=1"
+#endif
+
+#define VA_TEST_CPU_HZ      100000000u
+#define VA_TEST_RATE        2500u      /* sink budget, bytes per second */
+#define VA_TEST_BURST       64u
+#define VA_TEST_SECONDS     10u
+#define VA_TEST_EVENTS      2u         /* logged per drain period */
+#define VA_TEST_PACKET      14u        /* one VA_LogTrace packet */
+
+static uint64_t s_now;
+static uint64_t s_sink_bytes;
+
+static void _advance(uint32_t cycles)
+{
+    s_now += cycles;
+    va_mock_dwt.CYCCNT = (uint32_t)s_now;
+}
+
+static void _send(const uint8_t *data, uint32_t length)
+{
+    (void)data;
+    (void)length;
+}
+
+static void _sink(void *ctx, const uint8_t *packet, uint32_t length)
+{
+    (void)ctx;
+    (void)packet;
+    s_sink_bytes += length;
+}
+
+/* Returns the bytes the sink got over VA_TEST_SECONDS after the first one,
+ * with VA_Drain() every `period` cycles. */
+static uint64_t _run(uint32_t period)
+{
+    const VA_Sink_t sink = {_sink, NULL, VA_CLASS_BIT(VA_CLASS_USER), VA_TEST_RATE, VA_TEST_BURST};
+    int handle = VA_AddSink(&sink);
+    if (handle < 0)
+        return 0;
+
+    uint64_t start = 0;
+    uint32_t periods = (uint32_t)(((uint64_t)(VA_TEST_SECONDS + 1u) * VA_TEST_CPU_HZ) / period);
+    uint32_t warmup = VA_TEST_CPU_HZ / period;
+    for (uint32_t p = 0; p < periods; p++)
+    {
+        if (p == warmup)
+            start = s_sink_bytes;
+        for (uint32_t e = 0; e < VA_TEST_EVENTS; e++)
+            VA_LogTrace(1, (int32_t)p);
+        _advance(period);
+        (void)VA_Drain(0);
+    }
+    VA_RemoveSink(handle);
+    return s_sink_bytes - start;
+}
+
+int main(void)
+{
+    /* 2.5 and 1.75 bytes of budget per drain */
+    static const uint32_t periods[] = {VA_TEST_CPU_HZ / 1000u, 70000u};
+    int failed = 0;
+
+    VA_Init(VA_TEST_CPU_HZ);
+    VA_RegisterTransportSend(_send);
+    VA_RegisterUserTrace(1, "Value", VA_USER_TYPE_GRAPH);
+    (void)VA_Drain(0);
+    s_now = va_mock_dwt.CYCCNT;
+
+    for (uint32_t i = 0; i < sizeof(periods) / sizeof(periods[0]); i++)
+    {
+        uint64_t got = _run(periods[i]);
+        uint64_t want = (uint64_t)VA_TEST_RATE * VA_TEST_SECONDS;
+        uint64_t diff = (got > want) ? got - want : want - got;
+        bool     ok = diff <= VA_TEST_PACKET;
+        printf("%s: drain every %u cycles, sink got %llu B/s, budget %u B/s\n", ok ? "PASS" : "FAIL",
+               (unsigned)periods[i], (unsigned long long)(got / VA_TEST_SECONDS), (unsigned)VA_TEST_RATE);
+        if (!ok)
+            failed = 1;
+    }
+    return failed;
+}
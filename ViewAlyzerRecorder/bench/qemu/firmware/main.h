@@ -0,0 +1,77 @@
+/**
+ * @file main.h
+ * @brief Board header for the QEMU MPS2 benchmark firmware.
+ *
+ * Pulls in the real CMSIS core header for the selected machine, so the
+ * recorder is compiled with the same intrinsics (PRIMASK, LDREX/STREX,
+ * DMB) it uses on silicon.  QEMU does not model the DWT, ITM or debug
+ * registers.  They are redirected to RAM copies with the same layout.
+ * Register accesses stay single loads/stores from a literal-pool base,
+ * so the instruction counts match the real code.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_QEMU_MAIN_H
+#define VA_QEMU_MAIN_H
+
+#include <stdint.h>
+
+typedef enum
+{
+    NonMaskableInt_IRQn   = -14,
+    HardFault_IRQn        = -13,
+    MemoryManagement_IRQn = -12,
+    BusFault_IRQn         = -11,
+    UsageFault_IRQn       = -10,
+#if defined(VA_QEMU_AN505)
+    SecureFault_IRQn      = -9,
+#endif
+    SVCall_IRQn           = -5,
+    DebugMonitor_IRQn     = -4,
+    PendSV_IRQn           = -2,
+    SysTick_IRQn          = -1,
+    UART0RX_IRQn          = 0
+} IRQn_Type;
+
+#if defined(VA_QEMU_AN505)
+/* MPS2+ AN505: Cortex-M33, no FPU/DSP in this configuration */
+#define __CM33_REV                0x0000U
+#define __SAUREGION_PRESENT       1U
+#define __MPU_PRESENT             1U
+#define __VTOR_PRESENT            1U
+#define __NVIC_PRIO_BITS          3U
+#define __Vendor_SysTickConfig    0U
+#define __FPU_PRESENT             0U
+#define __DSP_PRESENT             0U
+#include "core_cm33.h"
+#elif defined(VA_QEMU_AN385)
+/* MPS2 AN385: Cortex-M3 */
+#define __CM3_REV                 0x0201U
+#define __MPU_PRESENT             1U
+#define __VTOR_PRESENT            1U
+#define __NVIC_PRIO_BITS          3U
+#define __Vendor_SysTickConfig    0U
+#include "core_cm3.h"
+#else
+#error "Define VA_QEMU_AN385 or VA_QEMU_AN505"
+#endif
+
+extern DWT_Type       va_qemu_dwt;
+extern ITM_Type       va_qemu_itm;
+extern CoreDebug_Type va_qemu_core_debug;
+
+#undef DWT
+#undef ITM
+#undef CoreDebug
+#define DWT       (&va_qemu_dwt)
+#define ITM       (&va_qemu_itm)
+#define CoreDebug (&va_qemu_core_debug)
+
+#if (__ARM_ARCH >= 8)
+extern DCB_Type va_qemu_dcb;
+#undef DCB
+#define DCB (&va_qemu_dcb)
+#endif
+
+#endif /* VA_QEMU_MAIN_H */
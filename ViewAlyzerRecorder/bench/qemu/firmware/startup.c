@@ -0,0 +1,80 @@
+/**
+ * @file startup.c
+ * @brief Vector table, reset handler and semihosting I/O for the QEMU
+ *        benchmark firmware.
+ *
+ * Output and exit go through ARM semihosting (BKPT 0xAB), so QEMU must be
+ * started with -semihosting-config enable=on,target=native.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#include "va_qemu.h"
+
+#include <stdint.h>
+
+extern uint32_t _sidata, _sdata, _edata, _sbss, _ebss, _estack;
+extern int main(void);
+
+#define SEMIHOSTING_SYS_WRITE0 0x04u
+#define SEMIHOSTING_SYS_EXIT   0x18u
+#define ADP_STOPPED_APP_EXIT   0x20026u
+#define ADP_STOPPED_RUN_ERROR  0x20023u
+
+static uint32_t _semihost(uint32_t op, const void *arg)
+{
+    register uint32_t r0 __asm__("r0") = op;
+    register const void *r1 __asm__("r1") = arg;
+    __asm__ volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+    return r0;
+}
+
+void va_qemu_puts(const char *s)
+{
+    (void)_semihost(SEMIHOSTING_SYS_WRITE0, s);
+}
+
+void va_qemu_exit(int status)
+{
+    /* 32-bit semihosting only passes the reason; any failure is "run error" */
+    (void)_semihost(SEMIHOSTING_SYS_EXIT,
+                    (const void *)(uintptr_t)(status == 0 ? ADP_STOPPED_APP_EXIT : ADP_STOPPED_RUN_ERROR));
+    for (;;)
+    {
+    }
+}
+
+void Reset_Handler(void)
+{
+    uint32_t *src = &_sidata;
+    for (uint32_t *dst = &_sdata; dst < &_edata;)
+        *dst++ = *src++;
+    for (uint32_t *dst = &_sbss; dst < &_ebss;)
+        *dst++ = 0u;
+
+    va_qemu_exit(main());
+}
+
+static void Fault_Handler(void)
+{
+    va_qemu_puts("fault\n");
+    va_qemu_exit(1);
+}
+
+__attribute__((section(".isr_vector"), used))
+static void (*const s_vectors[16])(void) = {
+    (void (*)(void))(&_estack),
+    Reset_Handler,
+    Fault_Handler, /* NMI */
+    Fault_Handler, /* HardFault */
+    Fault_Handler, /* MemManage */
+    Fault_Handler, /* BusFault */
+    Fault_Handler, /* UsageFault */
+    Fault_Handler, /* SecureFault (ARMv8-M) */
+    0, 0, 0,
+    Fault_Handler, /* SVCall */
+    Fault_Handler, /* DebugMon */
+    0,
+    Fault_Handler, /* PendSV */
+    Fault_Handler, /* SysTick */
+};
@@ -0,0 +1,24 @@
+/**
+ * @file va_qemu.h
+ * @brief Shared declarations for the QEMU benchmark firmware.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_QEMU_H
+#define VA_QEMU_H
+
+/** Print a NUL-terminated string on the QEMU console (semihosting). */
+void va_qemu_puts(const char *s);
+
+/** Stop QEMU; a non-zero status makes qemu-system-arm exit with an error. */
+void va_qemu_exit(int status) __attribute__((noreturn));
+
+/* Measurement window markers.  The instruction-counting plugin starts
+ * counting when va_qemu_window_begin() is entered and stops when
+ * va_qemu_window_end() is entered; run_qemu_bench.py passes it their
+ * addresses.  Both must stay real, out-of-line functions. */
+void va_qemu_window_begin(void);
+void va_qemu_window_end(void);
+
+#endif /* VA_QEMU_H */
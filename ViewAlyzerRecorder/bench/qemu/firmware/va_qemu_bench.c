@@ -0,0 +1,298 @@
+/**
+ * @file va_qemu_bench.c
+ * @brief Runs every recorder hook inside a measurement window on QEMU MPS2.
+ *
+ * For each case the firmware prints "case <name> <calls>" over semihosting,
+ * calls the hook once to warm up (first-use registration happens outside
+ * the window), and then calls it <calls> times between
+ * va_qemu_window_begin() and va_qemu_window_end().  The TCG plugin counts
+ * the instructions executed inside each window.  run_qemu_bench.py
+ * subtracts the "(empty)" baseline and divides by <calls>.
+ *
+ * The recorder is built with the custom transport and a RAM sink.  QEMU
+ * does not model the ITM, and a sink keeps the numbers about the recorder
+ * rather than about a link.  With VA_USE_RING_BUFFER=1 the hooks only copy
+ * into the ring.  VA_Drain() then runs outside the window, which is the
+ * per-ISR cost that matters for that mode.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#include "ViewAlyzer.h"
+#include "va_qemu.h"
+
+#include <string.h>
+
+#define VA_QEMU_CALLS          16u
+#define VA_QEMU_CYCLES_PER_EVT 1000u
+#define VA_QEMU_STACK_WORDS    128u
+#define VA_QEMU_STACK_FILL     0xA5A5A5A5u
+#define VA_QEMU_BLOCK_SAMPLES  32u
+
+/* ================================================================
+ *  Register stand-ins (see main.h)
+ * ================================================================ */
+
+DWT_Type       va_qemu_dwt;
+ITM_Type       va_qemu_itm;
+CoreDebug_Type va_qemu_core_debug;
+#if (__ARM_ARCH >= 8)
+DCB_Type va_qemu_dcb;
+#endif
+
+/* ================================================================
+ *  Measurement window markers
+ * ================================================================ */
+
+__attribute__((noinline)) void va_qemu_window_begin(void)
+{
+    __asm__ volatile("" ::: "memory");
+}
+
+__attribute__((noinline)) void va_qemu_window_end(void)
+{
+    __asm__ volatile("" ::: "memory");
+}
+
+/* ================================================================
+ *  Transport sink
+ * ================================================================ */
+
+static uint8_t  s_sink[512];
+static uint32_t s_sink_len;
+
+static void _va_qemu_send(const uint8_t *data, uint32_t length)
+{
+    if (length > sizeof(s_sink) - s_sink_len)
+        s_sink_len = 0;
+    memcpy(&s_sink[s_sink_len], data, length);
+    s_sink_len += length;
+}
+
+/* ================================================================
+ *  RTOS adapter stand-in
+ * ================================================================ */
+
+typedef struct
+{
+    uint32_t stack[VA_QEMU_STACK_WORDS];
+} VA_QemuTask_t;
+
+typedef struct
+{
+    VA_QueueObjectType_t type;
+} VA_QemuObject_t;
+
+static VA_QemuTask_t   s_tasks[2];
+static VA_QemuObject_t s_queue = {VA_OBJECT_TYPE_QUEUE};
+static VA_QemuObject_t s_mutex = {VA_OBJECT_TYPE_MUTEX};
+static VA_QemuObject_t s_heap  = {VA_OBJECT_TYPE_HEAP};
+
+#if VA_HAS_RTOS
+VA_QueueObjectType_t va_adapter_get_queue_object_type(void *handle)
+{
+    return ((VA_QemuObject_t *)handle)->type;
+}
+
+uint32_t va_adapter_calculate_stack_usage(void *taskHandle)
+{
+    const VA_QemuTask_t *task = (const VA_QemuTask_t *)taskHandle;
+    uint32_t free_words = 0;
+    while (free_words < VA_QEMU_STACK_WORDS && task->stack[free_words] == VA_QEMU_STACK_FILL)
+        free_words++;
+    return VA_QEMU_STACK_WORDS - free_words;
+}
+
+uint32_t va_adapter_get_total_stack_size(void *taskHandle)
+{
+    (void)taskHandle;
+    return VA_QEMU_STACK_WORDS;
+}
+
+bool va_adapter_get_stack_region(void *taskHandle, VA_StackRegion_t *region)
+{
+    region->base = ((VA_QemuTask_t *)taskHandle)->stack;
+    region->words = VA_QEMU_STACK_WORDS;
+    region->fill = VA_QEMU_STACK_FILL;
+    region->unit_shift = 0;
+    return true;
+}
+
+void va_adapter_check_mutex_contention(void *queueObject, uint8_t queue_va_id)
+{
+    (void)queueObject;
+    (void)queue_va_id;
+}
+#endif /* VA_HAS_RTOS */
+
+/* ================================================================
+ *  Cases
+ * ================================================================ */
+
+static int16_t s_block[VA_QEMU_BLOCK_SAMPLES];
+
+__attribute__((noinline)) static void _case_empty(uint32_t i) { (void)i; }
+static void _case_trace(uint32_t i) { VA_LogTrace(1, (int32_t)i); }
+static void _case_trace_float(uint32_t i) { VA_LogTraceFloat(2, (float)i); }
+static void _case_trace_block(uint32_t i)
+{
+    (void)i;
+    VA_LogTraceBlock(3, VA_SAMPLE_INT16, s_block, VA_QEMU_BLOCK_SAMPLES, 1000u);
+}
+static void _case_string(uint32_t i)
+{
+    (void)i;
+    VA_LogString(4, "motor: setpoint reached");
+}
+static void _case_logf(uint32_t i) { VA_Logf(5, "adc ch%u = %d mV", (unsigned)(i & 7u), (int)i); }
+static void _case_toggle(uint32_t i) { VA_LogToggle(6, (i & 1u) != 0); }
+static void _case_event(uint32_t i) { VA_LogEvent(1, (i & 1u) ? USER_EVENT_END : USER_EVENT_START); }
+static void _case_isr_start(uint32_t i)
+{
+    (void)i;
+    VA_LogISRStart(VA_ISR_ID_SYSTICK);
+}
+static void _case_isr_end(uint32_t i)
+{
+    (void)i;
+    VA_LogISREnd(VA_ISR_ID_SYSTICK);
+}
+static void _case_counter(uint32_t i) { VA_LogCounter(7, i); }
+static void _case_gpio(uint32_t i) { VA_LogGPIO(1, (i & 1u) != 0); }
+static void _case_switch_in(uint32_t i) { va_taskswitchedin(&s_tasks[i & 1u]); }
+static void _case_switch_out(uint32_t i) { va_taskswitchedout(&s_tasks[i & 1u]); }
+static void _case_notify_give(uint32_t i) { va_logtasknotifygive(&s_tasks[0], &s_tasks[1], i); }
+static void _case_notify_take(uint32_t i) { va_logtasknotifytake(&s_tasks[1], i); }
+static void _case_queue_give(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectGive(&s_queue, 0);
+}
+static void _case_queue_take(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectTake(&s_queue, 10);
+}
+static void _case_mutex_take(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectTake(&s_mutex, 10);
+}
+static void _case_blocking(uint32_t i)
+{
+    (void)i;
+    va_logQueueObjectBlocking(&s_mutex);
+}
+static void _case_heap_alloc(uint32_t i) { va_logHeapAlloc(&s_heap, 64u + (i & 63u)); }
+static void _case_sleep_enter(uint32_t i)
+{
+    (void)i;
+    va_logSleepEnter(&s_tasks[0]);
+}
+
+typedef struct
+{
+    const char *name; /* no spaces: run_qemu_bench.py splits on whitespace */
+    void (*run)(uint32_t i);
+} VA_QemuCase_t;
+
+static const VA_QemuCase_t s_cases[] = {
+    {"(empty)", _case_empty},
+    {"VA_LogTrace", _case_trace},
+    {"VA_LogTraceFloat", _case_trace_float},
+    {"VA_LogTraceBlock(32xi16)", _case_trace_block},
+    {"VA_LogString(23ch)", _case_string},
+    {"VA_Logf(2args)", _case_logf},
+    {"VA_LogToggle", _case_toggle},
+    {"VA_LogEvent", _case_event},
+    {"VA_LogISRStart", _case_isr_start},
+    {"VA_LogISREnd", _case_isr_end},
+    {"VA_LogCounter", _case_counter},
+    {"VA_LogGPIO", _case_gpio},
+    {"va_taskswitchedin", _case_switch_in},
+    {"va_taskswitchedout", _case_switch_out},
+    {"va_logtasknotifygive", _case_notify_give},
+    {"va_logtasknotifytake", _case_notify_take},
+    {"va_logQueueObjectGive", _case_queue_give},
+    {"va_logQueueObjectTake", _case_queue_take},
+    {"va_logQueueObjectTake(mutex)", _case_mutex_take},
+    {"va_logQueueObjectBlocking", _case_blocking},
+    {"va_logHeapAlloc", _case_heap_alloc},
+    {"va_logSleepEnter", _case_sleep_enter},
+};
+
+/* ================================================================
+ *  Runner
+ * ================================================================ */
+
+static void _print_case(const char *name, uint32_t calls)
+{
+    char line[64];
+    size_t n = strlen(name);
+    if (n > sizeof(line) - 16u)
+        n = sizeof(line) - 16u;
+    memcpy(line, "case ", 5);
+    memcpy(&line[5], name, n);
+    n += 5;
+    line[n++] = ' ';
+
+    char digits[10];
+    int d = 0;
+    do
+    {
+        digits[d++] = (char)('0' + calls % 10u);
+        calls /= 10u;
+    } while (calls != 0u);
+    while (d > 0)
+        line[n++] = digits[--d];
+    line[n++] = '\n';
+    line[n] = '\0';
+    va_qemu_puts(line);
+}
+
+static void _setup(void)
+{
+    VA_RegisterTransportSend(_va_qemu_send);
+    VA_Init(25000000u); /* MPS2 FPGA clock */
+
+    VA_RegisterUserTrace(1, "LoopTime", VA_USER_TYPE_GRAPH);
+    VA_RegisterUserEvent(1, "process_sample");
+    VA_RegisterGPIO(1, "LED");
+
+    for (uint32_t t = 0; t < 2u; t++)
+    {
+        for (uint32_t w = 0; w < VA_QEMU_STACK_WORDS; w++)
+            s_tasks[t].stack[w] = (w < VA_QEMU_STACK_WORDS / 2u) ? VA_QEMU_STACK_FILL : w;
+        va_taskcreated(&s_tasks[t], t ? "Comms" : "Control");
+    }
+    va_logQueueObjectCreate(&s_queue, "rxQueue");
+    va_logQueueObjectCreate(&s_mutex, "busMutex");
+    va_logQueueObjectCreate(&s_heap, "heap");
+}
+
+int main(void)
+{
+    _setup();
+
+    for (size_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); c++)
+    {
+        void (*run)(uint32_t) = s_cases[c].run;
+
+        _print_case(s_cases[c].name, VA_QEMU_CALLS);
+        run(0);
+        (void)VA_Drain(0);
+
+        va_qemu_window_begin();
+        for (uint32_t i = 1; i <= VA_QEMU_CALLS; i++)
+        {
+            va_qemu_dwt.CYCCNT += VA_QEMU_CYCLES_PER_EVT;
+            run(i);
+        }
+        va_qemu_window_end();
+
+        (void)VA_Drain(0);
+    }
+
+    va_qemu_puts("done\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file va_insn_window.c
+ * @brief QEMU TCG plugin: counts guest instructions between two addresses.
+ *
+ * Counting starts when the translation block at `begin` executes and stops
+ * when the one at `end` executes.  Each window's count is written to
+ * `out`, one line per window.  The benchmark firmware opens one window per
+ * recorder hook (see va_qemu_window_begin / va_qemu_window_end).
+ *
+ *   qemu-system-arm ... -plugin libva_insn_window.so,begin=0x1234,end=0x1240,out=counts.txt
+ *
+ * Thumb symbol addresses (bit 0 set) are accepted as printed by nm.
+ * Single vCPU only, which is all the MPS2 machines have.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#include <qemu-plugin.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define VA_MAX_WINDOWS 256
+
+static uint64_t s_begin;
+static uint64_t s_end;
+static const char *s_out_path = "va_insn_windows.txt";
+
+static bool     s_counting;
+static uint64_t s_count;
+static uint64_t s_windows[VA_MAX_WINDOWS];
+static unsigned s_num_windows;
+
+/* udata of a block: its instruction count, with the marker it starts at
+ * (if any) in the top bits. */
+#define VA_TB_BEGIN (1ull << 62)
+#define VA_TB_END   (1ull << 63)
+#define VA_TB_COUNT (VA_TB_BEGIN - 1u)
+
+static void _tb_exec(unsigned int vcpu_index, void *udata)
+{
+    (void)vcpu_index;
+    uint64_t info = (uint64_t)(uintptr_t)udata;
+
+    if (info & VA_TB_END)
+    {
+        if (s_counting && s_num_windows < VA_MAX_WINDOWS)
+            s_windows[s_num_windows++] = s_count;
+        s_counting = false;
+        return;
+    }
+    if (info & VA_TB_BEGIN)
+    {
+        s_counting = true;
+        s_count = 0;
+    }
+    if (s_counting)
+        s_count += info & VA_TB_COUNT;
+}
+
+static void _tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    (void)id;
+    uint64_t pc = qemu_plugin_tb_vaddr(tb);
+    uint64_t info = qemu_plugin_tb_n_insns(tb);
+
+    if (pc == s_begin)
+        info |= VA_TB_BEGIN;
+    else if (pc == s_end)
+        info |= VA_TB_END;
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, _tb_exec, QEMU_PLUGIN_CB_NO_REGS,
+                                         (void *)(uintptr_t)info);
+}
+
+static void _at_exit(qemu_plugin_id_t id, void *p)
+{
+    (void)id;
+    (void)p;
+    FILE *f = fopen(s_out_path, "w");
+    if (f == NULL)
+        return;
+    for (unsigned i = 0; i < s_num_windows; i++)
+        fprintf(f, "%" PRIu64 "\n", s_windows[i]);
+    fclose(f);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    (void)info;
+    for (int i = 0; i < argc; i++)
+    {
+        if (strncmp(argv[i], "begin=", 6) == 0)
+            s_begin = strtoull(argv[i] + 6, NULL, 0) & ~1ull;
+        else if (strncmp(argv[i], "end=", 4) == 0)
+            s_end = strtoull(argv[i] + 4, NULL, 0) & ~1ull;
+        else if (strncmp(argv[i], "out=", 4) == 0)
+            s_out_path = argv[i] + 4;
+        else
+        {
+            fprintf(stderr, "va_insn_window: unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    if (s_begin == 0 || s_end == 0)
+    {
+        fprintf(stderr, "va_insn_window: begin= and end= are required\n");
+        return -1;
+    }
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, _tb_trans);
+    qemu_plugin_register_atexit_cb(id, _at_exit, NULL);
+    return 0;
+}
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+run_qemu_bench.py — per-API instruction counts and code size on QEMU MPS2.
+
+Boots a benchmark image from firmware/ under qemu-system-arm with the
+va_insn_window TCG plugin, turns the per-window instruction counts into
+instructions per call, adds each API's code size from the symbol table and
+prints a table.  With --budget the numbers are checked against a JSON
+budget and the script exits with status 1 if any API grew by more than
+--threshold percent, or if the budget file or an API's entry in it is
+missing.  --update-budget (re)writes the budget instead.
+
+Only the Python standard library is needed.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+WINDOW_BEGIN = "va_qemu_window_begin"
+WINDOW_END = "va_qemu_window_end"
+BASELINE_CASE = "(empty)"
+
+
+def read_symbols(nm: str, elf: str) -> dict:
+    """Map symbol name -> (address, size) for every sized text symbol."""
+    out = subprocess.run([nm, "-S", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    symbols = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 4 and parts[2] in ("T", "t"):
+            symbols[parts[3]] = (int(parts[0], 16), int(parts[1], 16))
+        elif len(parts) == 3 and parts[1] in ("T", "t"):
+            symbols[parts[2]] = (int(parts[0], 16), 0)
+    return symbols
+
+
+def run_qemu(args, symbols: dict) -> list:
+    """Boot the image and return [(case, calls, instructions)] in run order."""
+    begin = symbols[WINDOW_BEGIN][0]
+    end = symbols[WINDOW_END][0]
+
+    with tempfile.TemporaryDirectory() as tmp:
+        counts_path = os.path.join(tmp, "windows.txt")
+        plugin = f"{args.plugin},begin={begin:#x},end={end:#x},out={counts_path}"
+        cmd = [args.qemu, "-M", args.machine, "-nographic",
+               "-monitor", "none", "-serial", "none",
+               "-semihosting-config", "enable=on,target=native",
+               "-kernel", args.elf, "-plugin", plugin]
+        proc = subprocess.run(cmd, capture_output=True, text=True, timeout=args.timeout)
+        if proc.returncode != 0:
+            sys.stderr.write(proc.stdout + proc.stderr)
+            raise SystemExit(f"qemu exited with status {proc.returncode}")
+
+        cases = [(m.group(1), int(m.group(2)))
+                 for m in re.finditer(r"^case (\S+) (\d+)$", proc.stdout, re.MULTILINE)]
+        with open(counts_path) as f:
+            counts = [int(line) for line in f if line.strip()]
+
+    if len(cases) != len(counts):
+        raise SystemExit(f"{len(cases)} cases but {len(counts)} measurement windows")
+    return [(name, calls, insns) for (name, calls), insns in zip(cases, counts)]
+
+
+def build_results(runs: list, symbols: dict) -> dict:
+    """Instructions per call (baseline removed) and code size per API."""
+    base = next((insns / calls for name, calls, insns in runs if name == BASELINE_CASE), 0.0)
+    results = {}
+    for name, calls, insns in runs:
+        if name == BASELINE_CASE:
+            continue
+        function = name.split("(", 1)[0]
+        results[name] = {
+            "insns": round(insns / calls - base, 1),
+            "code_bytes": symbols.get(function, (0, 0))[1],
+        }
+    return results
+
+
+def check_budget(results: dict, budget: dict, threshold: float) -> list:
+    """Return a list of human-readable regressions."""
+    failures = []
+    for name, now in results.items():
+        ref = budget.get(name)
+        if ref is None:
+            failures.append(f"{name}: not in the budget")
+            continue
+        for key in ("insns", "code_bytes"):
+            limit = ref[key] * (1.0 + threshold / 100.0)
+            if ref[key] > 0 and now[key] > limit:
+                failures.append(f"{name}: {key} {now[key]} > budget {ref[key]} (+{threshold:g}%)")
+    return failures
+
+
+def print_table(title: str, results: dict, budget: dict) -> None:
+    print(f"\n{title}\n")
+    print(f"| {'API':<30} | {'insns/call':>10} | {'budget':>8} | {'code bytes':>10} |")
+    print(f"|{'-' * 32}|{'-' * 12}|{'-' * 10}|{'-' * 12}|")
+    for name, r in results.items():
+        ref = budget.get(name, {}).get("insns")
+        ref_text = f"{ref:g}" if ref is not None else "-"
+        print(f"| {name:<30} | {r['insns']:>10.1f} | {ref_text:>8} | {r['code_bytes']:>10} |")
+
+
+def main() -> int:
+    p = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    p.add_argument("--elf", required=True, help="benchmark image (va_qemu_*.elf)")
+    p.add_argument("--machine", default="mps2-an385", help="mps2-an385 or mps2-an505")
+    p.add_argument("--plugin", required=True, help="path to libva_insn_window.so")
+    p.add_argument("--qemu", default="qemu-system-arm")
+    p.add_argument("--nm", default="arm-none-eabi-nm")
+    p.add_argument("--budget", help="JSON budget file to check against")
+    p.add_argument("--threshold", type=float, default=5.0, help="allowed growth in percent")
+    p.add_argument("--update-budget", action="store_true", help="write the budget instead of checking")
+    p.add_argument("--timeout", type=int, default=120, help="seconds before qemu is killed")
+    args = p.parse_args()
+
+    symbols = read_symbols(args.nm, args.elf)
+    for marker in (WINDOW_BEGIN, WINDOW_END):
+        if marker not in symbols:
+            raise SystemExit(f"{marker} not found in {args.elf}")
+
+    results = build_results(run_qemu(args, symbols), symbols)
+
+    budget = {}
+    if args.budget and os.path.exists(args.budget) and not args.update_budget:
+        with open(args.budget) as f:
+            budget = json.load(f)
+
+    print_table(f"{os.path.basename(args.elf)} on {args.machine}", results, budget)
+
+    if args.update_budget:
+        if not args.budget:
+            raise SystemExit("--update-budget needs --budget")
+        os.makedirs(os.path.dirname(os.path.abspath(args.budget)), exist_ok=True)
+        with open(args.budget, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print(f"\nbudget written to {args.budget}")
+        return 0
+
+    if not args.budget:
+        return 0
+    if not budget:
+        print(f"\nno budget at {args.budget}; run with --update-budget to create it")
+        return 1
+
+    failures = check_budget(results, budget, args.threshold)
+    for failure in failures:
+        print(f"REGRESSION {failure}")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,77 @@
+/**
+ * @file va_decompress.cpp
+ * @brief Expand a VA_COMPRESS capture into plain ViewAlyzer COBS frames.
+ *
+ * Reads a byte stream captured from a recorder built with VA_COMPRESS=1
+ * (UART log, BLE dump, ...), decodes the compressed frames and writes every
+ * packet back out as its own COBS frame — the stream the recorder sends
+ * without compression, which ViewAlyzer and existing tools read as is.
+ *
+ * Build (CMake): target va_decompress
+ * Build (manual):
+ *   g++ -std=c++17 va_decompress.cpp ../viewalyzer_cobs.c -I.. -o va_decompress
+ *
+ * Run:
+ *   ./va_decompress capture.bin plain.bin
+ *   ./va_decompress < capture.bin > plain.bin
+ */
+
+#include "viewalyzer_cobs.h"
+#include "viewalyzer_lz_decoder.hpp"
+
+#include <cstdio>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    FILE *in = (argc > 1) ? std::fopen(argv[1], "rb") : stdin;
+    FILE *out = (argc > 2) ? std::fopen(argv[2], "wb") : stdout;
+    if (in == nullptr || out == nullptr) {
+        std::fprintf(stderr, "usage: %s [capture.bin [plain.bin]]\n", argv[0]);
+        return 1;
+    }
+
+    viewalyzer::LzDecoder decoder;
+    std::vector<uint8_t> frame;
+    std::vector<uint8_t> decoded;
+    std::vector<uint8_t> encoded;
+    std::vector<viewalyzer::LzDecoder::Packet> packets;
+    size_t bytesIn = 0;
+    size_t bytesOut = 0;
+    size_t packetsOut = 0;
+
+    int c;
+    while ((c = std::fgetc(in)) != EOF) {
+        ++bytesIn;
+        if (c != 0) {
+            frame.push_back(static_cast<uint8_t>(c));
+            continue;
+        }
+        if (frame.empty())
+            continue;
+
+        decoded.resize(frame.size());
+        size_t n = va_cobs_decode(frame.data(), frame.size(), decoded.data(), decoded.size());
+        frame.clear();
+        if (n == 0)
+            continue;
+
+        packets.clear();
+        decoder.decodeFrame(decoded.data(), n, packets);
+        for (const auto &p : packets) {
+            encoded.resize(va_cobs_max_encoded_len(p.size()));
+            size_t len = va_cobs_encode(p.data(), p.size(), encoded.data());
+            std::fwrite(encoded.data(), 1, len, out);
+            bytesOut += len;
+            ++packetsOut;
+        }
+    }
+
+    std::fprintf(stderr, "%zu bytes in, %zu packets / %zu bytes out, %u frames lost\n",
+                 bytesIn, packetsOut, bytesOut, decoder.framesLost());
+    if (in != stdin)
+        std::fclose(in);
+    if (out != stdout)
+        std::fclose(out);
+    return 0;
+}
@@ -1,6 +1,6 @@
 /**
  * @file viewalyzer_cobs.c
- * @brief COBS encoder implementation for ViewAlyzer UDP transport.
+ * @brief COBS encoder/decoder implementation for ViewAlyzer UDP transport.
  *
  * Copyright (c) 2025 Free Radical Labs
  * See LICENSE for details.
@@ -41,3 +41,33 @@ size_t va_cobs_encode(const uint8_t *input, size_t in_len, uint8_t *output)
 
     return out_idx;
 }
+
+size_t va_cobs_decode(const uint8_t *input, size_t in_len, uint8_t *output, size_t out_max)
+{
+    size_t out_idx = 0;
+    size_t i       = 0;
+
+    while (i < in_len)
+    {
+        uint8_t code = input[i++];
+        if (code == 0x00 || i + code - 1 > in_len)
+            return 0;
+
+        for (uint8_t k = 1; k < code; k++)
+        {
+            if (out_idx >= out_max)
+                return 0;
+            output[out_idx++] = input[i++];
+        }
+
+        /* Every block but the last, and any 0xFF block, stands for a 0x00 */
+        if (code != 0xFF && i < in_len)
+        {
+            if (out_idx >= out_max)
+                return 0;
+            output[out_idx++] = 0x00;
+        }
+    }
+
+    return out_idx;
+}
@@ -1,6 +1,6 @@
 /**
  * @file viewalyzer_cobs.h
- * @brief COBS (Consistent Overhead Byte Stuffing) encoder for ViewAlyzer UDP transport.
+ * @brief COBS (Consistent Overhead Byte Stuffing) encoder/decoder for ViewAlyzer UDP transport.
  *
  * Copyright (c) 2025 Free Radical Labs
  * See LICENSE for details.
@@ -31,6 +31,17 @@ extern "C" {
  */
 size_t va_cobs_encode(const uint8_t *input, size_t in_len, uint8_t *output);
 
+/**
+ * Decode one COBS frame.
+ *
+ * @param input     Encoded bytes, without the 0x00 frame delimiter.
+ * @param in_len    Length of input in bytes.
+ * @param output    Buffer for the decoded packet (at most in_len bytes).
+ * @param out_max   Size of output in bytes.
+ * @return          Decoded length, or 0 if the frame is malformed or too long.
+ */
+size_t va_cobs_decode(const uint8_t *input, size_t in_len, uint8_t *output, size_t out_max);
+
 /**
  * Returns the worst-case encoded length for a given input length.
  * Use this to size your output buffer.
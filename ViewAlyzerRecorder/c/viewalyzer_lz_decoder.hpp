@@ -0,0 +1,159 @@
+/**
+ * @file viewalyzer_lz_decoder.hpp
+ * @brief Host-side decoder for the recorder's compressed frames (VA_COMPRESS).
+ *
+ * With VA_COMPRESS=1 the embedded recorder packs the packets sent by one
+ * VA_Drain() call into COBS frames of type 0x19:
+ *
+ *   [0x19][reset << 7 | seq][params, reset frames only][LZSS bitstream]
+ *
+ * params is (window_bits - 8) << 4 | length_bits.  The bitstream is read MSB
+ * first: 1 + 8-bit literal, or 0 + (distance - 1) in window_bits +
+ * (length - 3) in length_bits.  The history carries over from frame to frame
+ * until the next reset frame.  Decompressed, it is a sequence of
+ * [LEB128 length][packet] records.
+ *
+ * Header-only, C++17.  Feed every COBS-decoded frame to decodeFrame(); frames
+ * of other types are passed through unchanged.
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ * See LICENSE for details.
+ */
+
+#ifndef VIEWALYZER_LZ_DECODER_HPP
+#define VIEWALYZER_LZ_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace viewalyzer {
+
+class LzDecoder {
+public:
+    static constexpr uint8_t kFrameCompressed = 0x19;
+
+    using Packet = std::vector<uint8_t>;
+
+    /**
+     * Append the packets carried by one COBS-decoded frame to @p packets.
+     *
+     * A frame that does not follow the previous one in sequence can't be
+     * decoded: it and every frame up to the next reset frame are skipped and
+     * counted in framesLost().
+     *
+     * @return false if the frame was skipped.
+     */
+    bool decodeFrame(const uint8_t *frame, size_t len, std::vector<Packet> &packets)
+    {
+        if (len == 0)
+            return true;
+        if (len < 2 || frame[0] != kFrameCompressed) {
+            packets.emplace_back(frame, frame + len);
+            return true;
+        }
+
+        const uint8_t ctl = frame[1];
+        const uint8_t seq = ctl & 0x7Fu;
+        size_t pos = 2;
+        if (ctl & 0x80u) {
+            if (len < 3)
+                return lose();
+            windowBits_ = 8u + (frame[2] >> 4);
+            lenBits_ = frame[2] & 0x0Fu;
+            hist_.assign(size_t(1) << windowBits_, 0);
+            filled_ = 0;
+            pos = 3;
+        } else if (!synced_ || seq != nextSeq_) {
+            return lose();
+        }
+        synced_ = true;
+        nextSeq_ = (seq + 1u) & 0x7Fu;
+
+        out_.clear();
+        if (!inflate(frame + pos, len - pos))
+            return lose();
+        split(packets);
+        return true;
+    }
+
+    uint32_t framesLost() const { return framesLost_; }
+
+private:
+    bool lose()
+    {
+        ++framesLost_;
+        synced_ = false;
+        return false;
+    }
+
+    void push(uint8_t b)
+    {
+        hist_[filled_ & (hist_.size() - 1)] = b;
+        ++filled_;
+        out_.push_back(b);
+    }
+
+    bool inflate(const uint8_t *in, size_t len)
+    {
+        const size_t nbits = len * 8;
+        size_t bit = 0;
+        auto take = [&](unsigned n) {
+            uint32_t v = 0;
+            for (unsigned i = 0; i < n; ++i, ++bit)
+                v = (v << 1) | ((in[bit >> 3] >> (7u - (bit & 7u))) & 1u);
+            return v;
+        };
+
+        const size_t backrefBits = 1u + windowBits_ + lenBits_;
+        while (nbits - bit >= 9) {
+            if (take(1)) {
+                push(static_cast<uint8_t>(take(8)));
+                continue;
+            }
+            if (nbits - bit < backrefBits - 1)
+                break; /* zero padding */
+            const size_t dist = take(windowBits_) + 1u;
+            const size_t count = take(lenBits_) + 3u;
+            if (dist > filled_ || dist > hist_.size())
+                return false;
+            for (size_t i = 0; i < count; ++i)
+                push(hist_[(filled_ - dist) & (hist_.size() - 1)]);
+        }
+        return true;
+    }
+
+    void split(std::vector<Packet> &packets) const
+    {
+        size_t i = 0;
+        while (i < out_.size()) {
+            size_t length = 0;
+            unsigned shift = 0;
+            uint8_t b;
+            do {
+                if (i >= out_.size())
+                    return;
+                b = out_[i++];
+                length |= size_t(b & 0x7Fu) << shift;
+                shift += 7;
+            } while (b & 0x80u);
+            if (length > out_.size() - i)
+                return;
+            packets.emplace_back(out_.begin() + i, out_.begin() + i + length);
+            i += length;
+        }
+    }
+
+    std::vector<uint8_t> hist_;
+    std::vector<uint8_t> out_;
+    size_t   filled_ = 0;
+    unsigned windowBits_ = 0;
+    unsigned lenBits_ = 0;
+    uint8_t  nextSeq_ = 0;
+    bool     synced_ = false;
+    uint32_t framesLost_ = 0;
+};
+
+} // namespace viewalyzer
+
+#endif /* VIEWALYZER_LZ_DECODER_HPP */
@@ -22,6 +22,7 @@
   #define VA_INVALID_SOCKET INVALID_SOCKET
 #else
   #include <sys/socket.h>
+  #include <sys/select.h>
   #include <arpa/inet.h>
   #include <unistd.h>
   typedef int va_socket_t;
@@ -46,6 +47,23 @@ struct va_udp_ctx
     uint8_t  batch_buf[VA_UDP_BATCH_MAX];
     size_t   batch_len;
     int      batch_depth; /* nesting counter — flush only when depth reaches 0 */
+
+    /* Event filter set by host commands */
+    bool     stopped;
+    uint8_t  class_off;                          /* bit per VA_UDP_CLASS_* */
+    uint32_t id_off[VA_UDP_CLASS_COUNT][8];      /* bit per id */
+    va_udp_setup_fn setup_fn;
+    void           *setup_fn_arg;
+};
+
+/* Filter class of each event code; setup packets (0x70+) are never filtered */
+static const uint8_t va_udp_event_class[] = {
+    VA_UDP_CLASS_SYSTEM, VA_UDP_CLASS_TASK, VA_UDP_CLASS_ISR,  VA_UDP_CLASS_TASK,   /* 0x00-0x03 */
+    VA_UDP_CLASS_USER,   VA_UDP_CLASS_TASK, VA_UDP_CLASS_SYNC, VA_UDP_CLASS_SYNC,   /* 0x04-0x07 */
+    VA_UDP_CLASS_SYNC,   VA_UDP_CLASS_TASK, VA_UDP_CLASS_USER, VA_UDP_CLASS_USER,   /* 0x08-0x0B */
+    VA_UDP_CLASS_SYNC,   VA_UDP_CLASS_LOG,  VA_UDP_CLASS_USER, VA_UDP_CLASS_USER,   /* 0x0C-0x0F */
+    VA_UDP_CLASS_USER,   VA_UDP_CLASS_SYSTEM, VA_UDP_CLASS_SYSTEM, VA_UDP_CLASS_SYNC, /* 0x10-0x13 */
+    VA_UDP_CLASS_SYSTEM, VA_UDP_CLASS_SYSTEM, VA_UDP_CLASS_LOG, VA_UDP_CLASS_USER,  /* 0x14-0x17 */
 };
 
 /* ── Sync marker ──────────────────────────────────────────────────────── */
@@ -58,6 +76,7 @@ static const uint8_t VA_SYNC_MARKER[12] = {
 /* ── Helpers ──────────────────────────────────────────────────────────── */
 
 static void write_u16_le(uint8_t *buf, uint16_t v) { memcpy(buf, &v, 2); }
+static void write_u32_le(uint8_t *buf, uint32_t v) { memcpy(buf, &v, 4); }
 static void write_i32_le(uint8_t *buf, int32_t v)  { memcpy(buf, &v, 4); }
 static void write_u64_le(uint8_t *buf, uint64_t v) { memcpy(buf, &v, 8); }
 static void write_f32_le(uint8_t *buf, float v)    { memcpy(buf, &v, 4); }
@@ -124,6 +143,109 @@ void va_udp_set_send_fn(va_udp_ctx_t *ctx, va_udp_send_fn fn, void *arg)
     }
 }
 
+void va_udp_set_setup_fn(va_udp_ctx_t *ctx, va_udp_setup_fn fn, void *arg)
+{
+    if (ctx) {
+        ctx->setup_fn     = fn;
+        ctx->setup_fn_arg = arg;
+    }
+}
+
+/* ── Public: remote control ───────────────────────────────────────────── */
+
+static bool va_udp_allows(const va_udp_ctx_t *ctx, const uint8_t *pkt, size_t pkt_len)
+{
+    uint8_t type = pkt[0] & (uint8_t)~VA_UDP_FLAG_START;
+    if (pkt_len < 2 || type >= sizeof(va_udp_event_class))
+        return true;   /* setup packets and the sync marker always go out */
+
+    uint8_t cls = va_udp_event_class[type];
+    uint8_t id  = pkt[1];
+    return !ctx->stopped &&
+           ((ctx->class_off >> cls) & 1u) == 0 &&
+           ((ctx->id_off[cls][id >> 5] >> (id & 31u)) & 1u) == 0;
+}
+
+static void va_udp_run_command(va_udp_ctx_t *ctx, const uint8_t *cmd, size_t len)
+{
+    switch (cmd[0])
+    {
+    case VA_UDP_CMD_START:
+        ctx->stopped = false;
+        break;
+    case VA_UDP_CMD_STOP:
+        ctx->stopped = true;
+        break;
+    case VA_UDP_CMD_SETUP_BUNDLE:
+        if (ctx->setup_fn)
+            ctx->setup_fn(ctx->setup_fn_arg);
+        break;
+    case VA_UDP_CMD_SET_CLASSES:
+        if (len >= 2)
+            ctx->class_off = (uint8_t)(~cmd[1] & ((1u << VA_UDP_CLASS_COUNT) - 1u));
+        break;
+    case VA_UDP_CMD_SET_ID:
+        if (len >= 4 && cmd[1] < VA_UDP_CLASS_COUNT) {
+            uint32_t bit = 1u << (cmd[2] & 31u);
+            if (cmd[3])
+                ctx->id_off[cmd[1]][cmd[2] >> 5] &= ~bit;
+            else
+                ctx->id_off[cmd[1]][cmd[2] >> 5] |= bit;
+        }
+        break;
+    case VA_UDP_CMD_SET_ALL_IDS:
+        if (len >= 3 && cmd[1] < VA_UDP_CLASS_COUNT)
+            memset(ctx->id_off[cmd[1]], cmd[2] ? 0x00 : 0xFF, sizeof(ctx->id_off[cmd[1]]));
+        break;
+    default:
+        break;
+    }
+}
+
+int va_udp_receive_commands(va_udp_ctx_t *ctx, const uint8_t *data, size_t len)
+{
+    int applied = 0;
+    size_t start = 0;
+    if (!ctx || !data) return 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (data[i] != 0x00)
+            continue;
+        uint8_t cmd[16];
+        size_t n = va_cobs_decode(&data[start], i - start, cmd, sizeof(cmd));
+        if (n > 0) {
+            va_udp_run_command(ctx, cmd, n);
+            applied++;
+        }
+        start = i + 1;
+    }
+    return applied;
+}
+
+int va_udp_poll_commands(va_udp_ctx_t *ctx)
+{
+    int applied = 0;
+    if (!ctx) return 0;
+
+    for (;;)
+    {
+        fd_set readable;
+        struct timeval no_wait = {0, 0};
+        FD_ZERO(&readable);
+        FD_SET(ctx->sock, &readable);
+        if (select((int)ctx->sock + 1, &readable, NULL, NULL, &no_wait) <= 0)
+            break;
+
+        uint8_t buf[256];
+        int n = recvfrom(ctx->sock, (char *)buf, (int)sizeof(buf), 0, NULL, NULL);
+        if (n <= 0)
+            break;
+        applied += va_udp_receive_commands(ctx, buf, (size_t)n);
+    }
+    return applied;
+}
+
 /* ── Public: batching ─────────────────────────────────────────────────── */
 
 void va_udp_batch_begin(va_udp_ctx_t *ctx)
@@ -155,6 +277,9 @@ void va_udp_batch_flush(va_udp_ctx_t *ctx)
 
 void va_udp_send_raw_framed(va_udp_ctx_t *ctx, const uint8_t *pkt, size_t pkt_len)
 {
+    if (!va_udp_allows(ctx, pkt, pkt_len))
+        return;
+
     uint8_t buf[VA_UDP_COBS_BUF_LEN];
     size_t encoded_len = va_cobs_encode(pkt, pkt_len, buf);
 
@@ -241,6 +366,38 @@ void va_udp_send_trace_float(va_udp_ctx_t *ctx, uint8_t trace_id,
     va_udp_send_raw_framed(ctx, pkt, 14);
 }
 
+void va_udp_send_trace_block(va_udp_ctx_t *ctx, uint8_t trace_id,
+                             uint64_t timestamp, uint8_t sample_type,
+                             const void *samples, uint16_t count,
+                             uint32_t period_cycles)
+{
+    if (!samples || count == 0)
+        return;
+
+    size_t sample_size = (sample_type == VA_UDP_SAMPLE_INT16) ? 2 : 4;
+    size_t per_pkt     = VA_UDP_MAX_STRING_LEN / sample_size;
+    const uint8_t *src = (const uint8_t *)samples;
+
+    uint8_t pkt[17 + VA_UDP_MAX_STRING_LEN];
+    for (size_t done = 0; done < count; )
+    {
+        size_t chunk = count - done;
+        if (chunk > per_pkt)
+            chunk = per_pkt;
+
+        pkt[0]  = VA_UDP_EVT_TRACE_BLOCK;
+        pkt[1]  = trace_id;
+        write_u64_le(&pkt[2],  timestamp + (uint64_t)done * period_cycles);
+        pkt[10] = sample_type;
+        write_u16_le(&pkt[11], (uint16_t)chunk);
+        write_u32_le(&pkt[13], period_cycles);
+        memcpy(&pkt[17], src + done * sample_size, chunk * sample_size);
+        va_udp_send_raw_framed(ctx, pkt, 17 + chunk * sample_size);
+
+        done += chunk;
+    }
+}
+
 void va_udp_send_toggle(va_udp_ctx_t *ctx, uint8_t toggle_id,
                         uint64_t timestamp, bool state)
 {
@@ -14,7 +14,10 @@
  *   1. Call va_udp_init() with destination IP, port, and CPU frequency.
  *   2. Send setup packets: va_udp_send_trace_setup(), va_udp_send_function_map().
  *   3. In your loop, send events: va_udp_send_trace_int(), va_udp_send_trace_float(),
- *      va_udp_send_string(), va_udp_send_toggle(), va_udp_send_function().
+ *      va_udp_send_trace_block(), va_udp_send_string(), va_udp_send_toggle(),
+ *      va_udp_send_function().
+ *   4. Optionally call va_udp_poll_commands() in the same loop so the desktop
+ *      app can start/stop recording and filter events.
  *
  * Copyright (c) 2025 Free Radical Labs
  * See LICENSE for details.
@@ -39,6 +42,7 @@ extern "C" {
 #define VA_UDP_EVT_USER_FUNCTION    0x0B
 #define VA_UDP_EVT_STRING_EVENT     0x0D  /* variable-length string */
 #define VA_UDP_EVT_FLOAT_TRACE      0x0E  /* IEEE 754 float value */
+#define VA_UDP_EVT_TRACE_BLOCK      0x17  /* packed array of periodic samples */
 
 #define VA_UDP_FLAG_START           0x80  /* MSB: start/enter */
 
@@ -56,11 +60,33 @@ extern "C" {
 #define VA_UDP_TRACE_HISTOGRAM  5
 #define VA_UDP_TRACE_REGISTER   9
 
+/* Sample encodings for trace blocks (byte 10 of a TraceBlock packet) */
+#define VA_UDP_SAMPLE_INT16     0
+#define VA_UDP_SAMPLE_INT32     1
+#define VA_UDP_SAMPLE_FLOAT32   2
+
 /* Maximum string length for string events (2-byte length field, uint16_t LE) */
 #define VA_UDP_MAX_STRING_LEN   1024
 
-/* Max raw packet size (header + string) and COBS encode buffer size */
-#define VA_UDP_MAX_PKT_LEN      (12 + VA_UDP_MAX_STRING_LEN)
+/* Host-to-sender commands, each one COBS frame (same codes as the firmware recorder) */
+#define VA_UDP_CMD_START            0x01  /* [0x01]                 resume sending events */
+#define VA_UDP_CMD_STOP             0x02  /* [0x02]                 stop sending events */
+#define VA_UDP_CMD_SETUP_BUNDLE     0x03  /* [0x03]                 re-send setup (va_udp_set_setup_fn) */
+#define VA_UDP_CMD_SET_CLASSES      0x04  /* [0x04][mask]           bit n enables class n */
+#define VA_UDP_CMD_SET_ID           0x05  /* [0x05][class][id][on]  enable or disable one id */
+#define VA_UDP_CMD_SET_ALL_IDS      0x06  /* [0x06][class][on]      enable or disable every id */
+
+/* Event classes for the command filter */
+#define VA_UDP_CLASS_TASK           0     /* task switch, create, notify, stack usage */
+#define VA_UDP_CLASS_ISR            1
+#define VA_UDP_CLASS_SYNC           2     /* semaphores, mutexes, queues, contention */
+#define VA_UDP_CLASS_USER           3     /* traces, toggles, functions, sample blocks */
+#define VA_UDP_CLASS_LOG            4     /* string events */
+#define VA_UDP_CLASS_SYSTEM         5
+#define VA_UDP_CLASS_COUNT          6
+
+/* Max raw packet size (trace block header + payload) and COBS encode buffer size */
+#define VA_UDP_MAX_PKT_LEN      (17 + VA_UDP_MAX_STRING_LEN)
 #define VA_UDP_COBS_BUF_LEN     (VA_UDP_MAX_PKT_LEN + (VA_UDP_MAX_PKT_LEN / 254) + 2)
 
 /* ── Context ───────────────────────────────────────────────────────────── */
@@ -93,6 +119,15 @@ va_udp_ctx_t *va_udp_init(const char *dest_ip, uint16_t dest_port, uint32_t cpu_
  */
 void va_udp_set_send_fn(va_udp_ctx_t *ctx, va_udp_send_fn fn, void *arg);
 
+/**
+ * Callback for VA_UDP_CMD_SETUP_BUNDLE.  The library does not keep the
+ * names it sent, so the application re-sends its setup packets here.
+ */
+typedef void (*va_udp_setup_fn)(void* arg);
+
+/** Set the callback that runs when the host asks for the setup packets. */
+void va_udp_set_setup_fn(va_udp_ctx_t *ctx, va_udp_setup_fn fn, void *arg);
+
 /** Close the socket and free the context. */
 void va_udp_close(va_udp_ctx_t *ctx);
 
@@ -118,6 +153,22 @@ void va_udp_send_trace_int(va_udp_ctx_t *ctx, uint8_t trace_id,
 void va_udp_send_trace_float(va_udp_ctx_t *ctx, uint8_t trace_id,
                              uint64_t timestamp, float value);
 
+/**
+ * Block of evenly spaced samples for one trace (TraceBlock 0x17).
+ *
+ * @param timestamp     Timestamp of samples[0], in CPU cycles.
+ * @param sample_type   VA_UDP_SAMPLE_INT16, _INT32 or _FLOAT32.
+ * @param samples       Array of @p count samples of that type.
+ * @param period_cycles Cycles between consecutive samples.
+ *
+ * Blocks larger than VA_UDP_MAX_STRING_LEN bytes are split into several
+ * packets, each timestamped at its first sample.
+ */
+void va_udp_send_trace_block(va_udp_ctx_t *ctx, uint8_t trace_id,
+                             uint64_t timestamp, uint8_t sample_type,
+                             const void *samples, uint16_t count,
+                             uint32_t period_cycles);
+
 /** Boolean toggle state change. */
 void va_udp_send_toggle(va_udp_ctx_t *ctx, uint8_t toggle_id,
                         uint64_t timestamp, bool state);
@@ -130,6 +181,23 @@ void va_udp_send_function(va_udp_ctx_t *ctx, uint8_t func_id,
 void va_udp_send_string(va_udp_ctx_t *ctx, uint8_t msg_id,
                         uint64_t timestamp, const char *message);
 
+/* ── Remote control ──────────────────────────────────────────────────── */
+
+/**
+ * Read pending commands from the socket without blocking and apply them.
+ * The desktop app replies to the port the events come from, so call this
+ * after the first packet has been sent.
+ * @return Number of commands applied.
+ */
+int va_udp_poll_commands(va_udp_ctx_t *ctx);
+
+/**
+ * Apply commands received some other way (e.g. with a custom send_fn
+ * transport).  @p data holds one or more COBS frames, each ending in 0x00.
+ * @return Number of commands applied.
+ */
+int va_udp_receive_commands(va_udp_ctx_t *ctx, const uint8_t *data, size_t len);
+
 /* ── Batching ───────────────────────────────────────────────────────────── */
 
 /**
@@ -0,0 +1,131 @@
+/**
+ * @file VA_FastPath.h
+ * @brief ViewAlyzer Internal — inline emitters for the highest-volume events.
+ *
+ * ISR enter/exit, task switch and user event start/end make up most of a
+ * trace.  With VA_INLINE_FAST_PATH=1 their packets skip the generic
+ * _va_send_event_packet → _va_emit_packet → _va_send_bytes chain: the packet
+ * is packed into little-endian words in registers and stored straight into
+ * a ring slot, the ITM stimulus port or the RTT buffer.
+ *
+ * The wire format does not change:
+ *   [type][id][timestamp u64 LE]          (10 bytes)
+ *   [type][id][timestamp u64 LE][core]    (11 bytes, core events, VA_NUM_CORES > 1)
+ *
+ * Copyright (c) 2025 Free Radical Labs
+ */
+
+#ifndef VA_FASTPATH_H
+#define VA_FASTPATH_H
+
+#include "VA_Internal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (VA_ENABLED == 1) && VA_INLINE_FAST_PATH
+
+#if VA_FLIGHT_RECORDER || VA_COMPACT_TIMESTAMPS
+#error "VA_INLINE_FAST_PATH cannot be combined with VA_FLIGHT_RECORDER or VA_COMPACT_TIMESTAMPS"
+#endif
+#if VA_TRANSPORT_IS_ITM && VA_ITM_NONBLOCKING
+#error "VA_INLINE_FAST_PATH cannot be combined with VA_ITM_NONBLOCKING"
+#endif
+#if VA_TRANSPORT_IS_FRAMED && !VA_USE_RING_BUFFER
+#error "VA_INLINE_FAST_PATH with a COBS-framed transport needs VA_USE_RING_BUFFER (COBS framing happens in VA_Drain)"
+#endif
+
+#if VA_TRANSPORT_IS_JLINK && !VA_USE_RING_BUFFER && !VA_RTT_ZERO_COPY
+#include "SEGGER_RTT.h"
+#endif
+
+/* Port or channel of a packet's class (VA_ROUTE_BY_CLASS), ViewAlyzer.c */
+#if VA_ROUTE_BY_CLASS && !VA_USE_RING_BUFFER
+static inline uint32_t _va_route(uint8_t type_byte);
+#define VA_FAST_ROUTE(w0) _va_route((uint8_t)(w0))
+#else
+#define VA_FAST_ROUTE(w0) ((uint32_t)VA_ROUTE_MAIN)
+#endif
+
+/* Store up to 12 packet bytes held in three words.  Byte i of the packet
+ * is byte (i % 4) of word (i / 4), so on the little-endian Cortex-M the
+ * words are the packet's memory image. */
+static inline void _va_fast_store(uint32_t w0, uint32_t w1, uint32_t w2, uint32_t length)
+{
+    if (!VA_IS_INIT)
+        return;
+
+#if VA_USE_RING_BUFFER
+    /* Ring slots are word aligned and padded to a whole word */
+    uint32_t *slot = (uint32_t *)(void *)_va_ring_reserve(length, (uint8_t)w0);
+    if (slot == NULL)
+        return;
+    slot[0] = w0;
+    slot[1] = w1;
+    slot[2] = w2;
+    _va_ring_commit((uint8_t *)slot, length);
+#elif VA_TRANSPORT_IS_ITM
+    /* Single core only (multi-core needs the ring), so length is 10 */
+    VA_UNUSED(length);
+    uint32_t port = VA_FAST_ROUTE(w0);
+#if VA_ROUTE_BY_CLASS
+    if (((ITM->TER >> port) & 1u) == 0u)
+        return;
+#endif
+    while (ITM->PORT[port].u32 == 0)
+        ;
+    ITM->PORT[port].u32 = w0;
+    while (ITM->PORT[port].u32 == 0)
+        ;
+    ITM->PORT[port].u32 = w1;
+    while (ITM->PORT[port].u32 == 0)
+        ;
+    ITM->PORT[port].u16 = (uint16_t)w2;
+#elif VA_TRANSPORT_IS_JLINK && VA_RTT_ZERO_COPY
+    uint32_t words[3] = {w0, w1, w2};
+    _va_rtt_write((const uint8_t *)words, length);
+#elif VA_TRANSPORT_IS_JLINK
+    uint32_t words[3] = {w0, w1, w2};
+    SEGGER_RTT_Write(VA_FAST_ROUTE(w0), words, length);
+#endif
+
+#if (VA_AUTO_SETUP_INTERVAL_MS > 0) || ((VA_SETUP_BUNDLE_CHUNK > 0) && !VA_USE_RING_BUFFER)
+    _va_after_emit();
+#endif
+}
+
+/* [type][id][timestamp] — same bytes as _va_send_event_packet().
+ * Call inside VA_CS_ENTER()/VA_CS_EXIT(). */
+static inline void _va_fast_event(uint8_t type_byte, uint8_t id, uint64_t timestamp)
+{
+    uint32_t lo = (uint32_t)timestamp;
+    uint32_t hi = (uint32_t)(timestamp >> 32);
+    _va_fast_store((uint32_t)type_byte | ((uint32_t)id << 8) | (lo << 16),
+                   (lo >> 16) | (hi << 16),
+                   hi >> 16,
+                   10u);
+}
+
+/* Task-switch and ISR events: multi-core builds append the core id */
+static inline void _va_fast_core_event(uint8_t type_byte, uint8_t id, uint64_t timestamp)
+{
+#if VA_NUM_CORES > 1
+    uint32_t lo = (uint32_t)timestamp;
+    uint32_t hi = (uint32_t)(timestamp >> 32);
+    _va_fast_store((uint32_t)type_byte | ((uint32_t)id << 8) | (lo << 16),
+                   (lo >> 16) | (hi << 16),
+                   (hi >> 16) | ((va_adapter_get_core_id() & 0xFFu) << 16),
+                   11u);
+#else
+    _va_fast_event(type_byte, id, timestamp);
+#endif
+}
+
+#endif /* VA_ENABLED && VA_INLINE_FAST_PATH */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_FASTPATH_H */
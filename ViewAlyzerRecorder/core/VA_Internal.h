@@ -37,6 +37,27 @@ extern "C" {
 
 #define VA_UNUSED(x) (void)(x)
 
+/* ── Recording filter (VA_REMOTE_CONTROL) ──────────────────────── */
+#if VA_REMOTE_CONTROL
+#define VA_CTL_STOPPED 0x80u
+typedef struct
+{
+    volatile uint8_t  off;                         /* bit n: class n disabled; VA_CTL_STOPPED */
+    volatile uint32_t id_off[VA_CLASS_COUNT][8];   /* bit per id: disabled */
+} VA_Control_t;
+extern VA_Control_t _va_ctl;
+
+/* Checked before an event packet is built, so a filtered event costs one
+ * lookup and never touches the timestamp chain. */
+static inline bool _va_ctl_allows(uint8_t cls, uint8_t id)
+{
+    return ((_va_ctl.off & (VA_CTL_STOPPED | (1u << cls))) |
+            ((_va_ctl.id_off[cls][id >> 5] >> (id & 31u)) & 1u)) == 0u;
+}
+#else
+#define _va_ctl_allows(cls, id) (true)
+#endif
+
 /* ── Task / object map entry (RTOS-agnostic) ───────────────────── */
 typedef struct {
     void    *handle;                        /* Generic pointer to TCB / thread struct */
@@ -50,6 +71,12 @@ typedef struct {
     uint32_t uxPriority;
     uint32_t uxBasePriority;
     uint32_t ulStackDepth;
+#if VA_CAPTURE_STACK_USAGE && VA_STACK_CHANGE_ONLY
+    /* Incremental watermark state (words, see _va_sample_stack) */
+    uint32_t stack_free_words;
+    uint32_t stack_scan_cursor;
+    uint32_t stack_last_reported;
+#endif
 } VA_TaskMapEntry_t;
 
 /* ── Queue / sync-object map entry (RTOS-agnostic) ─────────────── */
@@ -83,6 +110,29 @@ extern uint8_t                  next_queue_object_id;
 uint64_t _va_get_timestamp(void);
 
 void _va_emit_packet(const uint8_t *data, uint32_t length);
+/* Periodic / incremental setup-bundle work that follows every emitted
+ * packet.  _va_emit_packet() calls it; so does the inline fast path. */
+void _va_after_emit(void);
+
+#if VA_USE_RING_BUFFER
+/* Reserve room for one packet in the deferred-drain ring.  Returns a pointer
+ * to `length` contiguous bytes, or NULL if the ring is full — or, with
+ * VA_PRIORITY_SHEDDING, past the level of the class of `type_byte` (the
+ * packet's first byte).  NULL means the packet is counted as dropped.  Safe
+ * from any priority level, including nested ISRs.  Every successful reserve
+ * must be followed by _va_ring_commit(). */
+uint8_t *_va_ring_reserve(uint32_t length, uint8_t type_byte);
+void     _va_ring_commit(uint8_t *payload, uint32_t length);
+#endif
+#if VA_TRANSPORT_IS_JLINK && VA_RTT_ZERO_COPY
+/* Zero-copy RTT (see ViewAlyzer.c).  _va_rtt_reserve() returns `length`
+ * contiguous bytes in the up-buffer, or NULL if the packet would wrap or
+ * does not fit; _va_rtt_commit() publishes them.  _va_rtt_write() copies a
+ * packet in, split at the wrap.  Call inside VA_CS_ENTER()/VA_CS_EXIT(). */
+uint8_t *_va_rtt_reserve(uint32_t length);
+void     _va_rtt_commit(uint8_t *payload, uint32_t length);
+void     _va_rtt_write(const uint8_t *data, uint32_t length);
+#endif
 void _va_send_event_packet(uint8_t type_byte, uint8_t id, uint64_t timestamp);
 void _va_send_setup_packet(uint8_t setupCode, uint8_t id, const char *name);
 void _va_send_user_setup_packet(uint8_t id, uint8_t type, const char *name);
@@ -103,6 +153,7 @@ uint8_t _va_assign_task_id(void *handle, const char *name);
 
 #if (VA_RTOS_SELECT != VA_RTOS_NONE)
 uint8_t              _va_find_queue_object_id(void *handle);
+int                  _va_find_queue_object_index(void *handle);
 uint8_t              _va_assign_queue_object_id(void *handle, const char *name, VA_QueueObjectType_t type);
 const char          *_va_get_object_type_name(VA_QueueObjectType_t type);
 uint8_t              _va_get_setup_packet_type(VA_QueueObjectType_t type);
@@ -30,7 +30,9 @@ extern "C"
 #if (VA_ENABLED == 1)
 
 #include "VA_Internal.h"
+#include "VA_FastPath.h"
 #include <string.h>
+#include <stddef.h>
 
 // Include RTT header only if needed
 #if VA_TRANSPORT_IS_JLINK
@@ -41,10 +43,18 @@ extern "C"
 #if VA_RTT_BUFFER_SIZE > 0
     static uint8_t s_va_rtt_up_buffer[VA_RTT_BUFFER_SIZE];
 #endif
+#if VA_REMOTE_CONTROL && (VA_CONFIGURE_RTT == 1) && (VA_RTT_DOWN_BUFFER_SIZE > 0)
+    static uint8_t s_va_rtt_down_buffer[VA_RTT_DOWN_BUFFER_SIZE];
+#endif
+#if VA_ROUTE_BY_CLASS && (VA_CONFIGURE_RTT == 1) && (VA_RTT_ROUTE_BUFFERS > 0)
+    static uint8_t s_va_rtt_route_buffers[VA_RTT_ROUTE_BUFFERS][VA_RTT_ROUTE_BUFFER_SIZE];
+#endif
 #endif
 
-#if VA_TRANSPORT_IS_CUSTOM
+#if VA_TRANSPORT_IS_FRAMED || VA_SINKS
 #include "viewalyzer_cobs.h"
+#endif
+#if VA_TRANSPORT_IS_CUSTOM
     static VA_TransportSendFn s_user_send_fn = NULL;
 #endif
 
@@ -108,8 +118,8 @@ static void _va_strcat_suffix(char *buf, size_t buf_size,
 
 #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__) || defined(__ARM_ARCH_8M_BASE__)
 #define DWT_ENABLED 1
-    static volatile uint32_t g_dwt_overflow_count = 0;
-    static volatile uint32_t g_dwt_last_value = 0;
+    // CYCCNT extension state, per core: (overflow count << 1) | MSB of the last CYCCNT seen
+    static volatile uint32_t g_dwt_epoch[VA_NUM_CORES];
 #else
 #define DWT_ENABLED 0
 #warning "ViewAlyzer requires DWT Cycle Counter (Cortex-M3/M4/M7). ViewAlyzer functions disabled."
@@ -131,7 +141,21 @@ static void _va_strcat_suffix(char *buf, size_t buf_size,
 
 #if VA_AUTO_SETUP_INTERVAL_MS > 0
     static uint64_t _va_last_bundle_ts = 0;
+#endif
+    // Setup bundle progress (see VA_EmitSetupBundle / VA_SETUP_BUNDLE_CHUNK)
     static bool     _va_emitting_bundle = false;
+    static bool     _va_bundle_active = false;      // an incremental cycle is in progress
+    static uint32_t _va_bundle_cursor = 0;          // next bundle entry to emit
+    static uint32_t _va_bundle_generation = 0;      // completed cycles, reported as "GEN:<n>"
+    static bool     _va_bundle_step(uint32_t budget);
+
+#if VA_COMPACT_TIMESTAMPS
+#if !VA_ALLOWED_TO_DISABLE_INTERRUPTS
+#error "VA_COMPACT_TIMESTAMPS needs VA_ALLOWED_TO_DISABLE_INTERRUPTS: deltas must be built and emitted atomically"
+#endif
+    // Delta base: timestamp of the last event (or anchor) put on the wire
+    static uint64_t      _va_last_ts = 0;
+    static volatile bool _va_ts_resync = false;   // a packet was lost, re-anchor before the next delta
 #endif
 
     volatile uint32_t notificationValue = 0;
@@ -166,17 +190,411 @@ static void _va_strcat_suffix(char *buf, size_t buf_size,
     } VA_UserTraceMapEntry_t;
     static VA_UserTraceMapEntry_t userTraceMap[VA_MAX_USER_EVENTS];
 
+#if VA_TRACE_USER_STRINGS
+    // VA_Logf() format table: each distinct format string (by address) gets
+    // an id and its argument kinds are parsed once, so a log call only packs
+    // binary arguments.  Re-emitted by the setup bundle like the maps above.
+    typedef struct
+    {
+        const char *fmt;
+        uint32_t    sig;                    /* VA_LOGF_ARG_* per argument, 4 bits each, first lowest; 0 ends */
+    } VA_LogFormatEntry_t;
+    static VA_LogFormatEntry_t logFormatMap[VA_MAX_LOG_FORMATS];
+    static uint8_t             next_log_format = 0;   // used entries; format id = index + 1
+#endif
+
 #if VA_HAS_RTOS
     // --- Queue / sync-object map (RTOS-agnostic storage, adapter determines type) ---
     VA_QueueObjectMapEntry_t queueObjectMap[VA_MAX_SYNC_OBJECTS];
     uint8_t next_queue_object_id = 1;
 #endif
 
+#if (VA_MAX_TASKS) > 255 || (VA_MAX_SYNC_OBJECTS) > 255 || (VA_MAX_LOG_FORMATS) > 255
+#error "VA_MAX_TASKS, VA_MAX_SYNC_OBJECTS and VA_MAX_LOG_FORMATS are limited to 255 (8-bit ids)"
+#endif
+
+    // --- Handle -> map-slot index (open addressing, linear probing) ---
+    // Each table has at least twice as many slots as its map so probe runs
+    // stay short; a slot holds map index + 1, 0 = empty.  Maps are
+    // insert-only until VA_Init(), so no tombstones are needed.
+#define VA_HASH_SLOTS(n) ((n) <= 8 ? 16u : (n) <= 16 ? 32u : (n) <= 32 ? 64u : \
+                          (n) <= 64 ? 128u : (n) <= 128 ? 256u : 512u)
+#define VA_TASK_HASH_SLOTS   VA_HASH_SLOTS(VA_MAX_TASKS)
+    static uint8_t taskHash[VA_TASK_HASH_SLOTS];
+#if VA_HAS_RTOS
+#define VA_OBJECT_HASH_SLOTS VA_HASH_SLOTS(VA_MAX_SYNC_OBJECTS)
+    static uint8_t queueObjectHash[VA_OBJECT_HASH_SLOTS];
+#endif
+#if VA_TRACE_USER_STRINGS
+#define VA_FORMAT_HASH_SLOTS VA_HASH_SLOTS(VA_MAX_LOG_FORMATS)
+    static uint8_t logFormatHash[VA_FORMAT_HASH_SLOTS];
+#endif
+
+/* ================================================================
+ *  Multi-core support
+ *
+ *  VA_CS_ENTER() only masks the calling core, so with VA_NUM_CORES > 1
+ *  the hot path keeps everything it writes per core (ring, cycle-counter
+ *  epoch) and the shared maps and bundle state are guarded by a spinlock.
+ *  The lock is only ever taken inside a critical section, so an ISR on
+ *  the same core can't spin on it, and it is recursive because map
+ *  updates emit setup packets that may start a bundle.  Lookups stay
+ *  lock-free: a map entry is complete before its hash slot publishes it.
+ * ================================================================ */
+#if VA_NUM_CORES > 1
+
+#if !VA_USE_RING_BUFFER
+#error "VA_NUM_CORES > 1 requires VA_USE_RING_BUFFER (per-core rings)"
+#endif
+#if !VA_ALLOWED_TO_DISABLE_INTERRUPTS
+#error "VA_NUM_CORES > 1 needs VA_ALLOWED_TO_DISABLE_INTERRUPTS"
+#endif
+#if VA_FLIGHT_RECORDER || VA_COMPACT_TIMESTAMPS
+#error "VA_NUM_CORES > 1 cannot be combined with VA_FLIGHT_RECORDER or VA_COMPACT_TIMESTAMPS"
+#endif
+
+#define VA_CORE_ID() va_adapter_get_core_id()
+
+static volatile uint32_t s_va_smp_owner = 0;   /* core id + 1, 0 = free */
+static uint32_t          s_va_smp_depth = 0;
+
+static void _va_smp_lock(void)
+{
+    uint32_t me = VA_CORE_ID() + 1u;
+    if (s_va_smp_owner == me)
+    {
+        s_va_smp_depth++;
+        return;
+    }
+    for (;;)
+    {
+        if (__LDREXW(&s_va_smp_owner) != 0u)
+        {
+            __CLREX();
+            continue;
+        }
+        if (__STREXW(me, &s_va_smp_owner) == 0u)
+            break;
+    }
+    __DMB();
+    s_va_smp_depth = 1;
+}
+
+static void _va_smp_unlock(void)
+{
+    if (--s_va_smp_depth == 0u)
+    {
+        __DMB();
+        s_va_smp_owner = 0;
+    }
+}
+
+#define VA_SMP_LOCK()   _va_smp_lock()
+#define VA_SMP_UNLOCK() _va_smp_unlock()
+#else
+#define VA_CORE_ID()    0u
+#define VA_SMP_LOCK()   ((void)0)
+#define VA_SMP_UNLOCK() ((void)0)
+#endif /* VA_NUM_CORES > 1 */
+
+/* ================================================================
+ *  Event classes
+ * ================================================================ */
+
+/* Class of each event type code (VA_EVENT_*, without the start flag).
+ * Setup codes, the sync marker and anything newer are VA_CLASS_SYSTEM. */
+static const uint8_t s_va_event_class[] = {
+    VA_CLASS_SYSTEM, /* 0x00 */
+    VA_CLASS_TASK,   /* 0x01 task switch */
+    VA_CLASS_ISR,    /* 0x02 ISR */
+    VA_CLASS_TASK,   /* 0x03 task create */
+    VA_CLASS_USER,   /* 0x04 user trace */
+    VA_CLASS_TASK,   /* 0x05 task notify */
+    VA_CLASS_SYNC,   /* 0x06 semaphore */
+    VA_CLASS_SYNC,   /* 0x07 mutex */
+    VA_CLASS_SYNC,   /* 0x08 queue */
+    VA_CLASS_TASK,   /* 0x09 stack usage */
+    VA_CLASS_USER,   /* 0x0A user toggle */
+    VA_CLASS_USER,   /* 0x0B user event */
+    VA_CLASS_SYNC,   /* 0x0C mutex contention */
+    VA_CLASS_LOG,    /* 0x0D string */
+    VA_CLASS_USER,   /* 0x0E float trace */
+    VA_CLASS_USER,   /* 0x0F GPIO */
+    VA_CLASS_USER,   /* 0x10 counter */
+    VA_CLASS_SYSTEM, /* 0x11 heap */
+    VA_CLASS_SYSTEM, /* 0x12 sleep */
+    VA_CLASS_SYNC,   /* 0x13 timer */
+    VA_CLASS_SYSTEM, /* 0x14 heap sync */
+    VA_CLASS_SYSTEM, /* 0x15 PM suspend */
+    VA_CLASS_LOG,    /* 0x16 formatted log */
+    VA_CLASS_USER,   /* 0x17 trace block */
+};
+
+static inline uint8_t _va_packet_class(uint8_t type_byte)
+{
+    uint8_t type = type_byte & VA_EVENT_TYPE_MASK;
+    return (type < sizeof(s_va_event_class)) ? s_va_event_class[type] : (uint8_t)VA_CLASS_SYSTEM;
+}
+
+/* ================================================================
+ *  Per-class routing (VA_ROUTE_BY_CLASS)
+ *
+ *  _va_route() picks the ITM stimulus port or RTT channel of a packet from
+ *  its type byte.  Without routing it is the one configured port.
+ * ================================================================ */
+#if VA_ROUTE_BY_CLASS
+#if !VA_TRANSPORT_IS_ITM && !VA_TRANSPORT_IS_JLINK
+#error "VA_ROUTE_BY_CLASS needs ARM_ITM or JLINK_RTT"
+#endif
+#if VA_COMPACT_TIMESTAMPS
+#error "VA_ROUTE_BY_CLASS cannot be combined with VA_COMPACT_TIMESTAMPS (one delta chain cannot span several streams)"
+#endif
+#if VA_TRANSPORT_IS_JLINK && VA_RTT_ZERO_COPY
+#error "VA_ROUTE_BY_CLASS cannot be combined with VA_RTT_ZERO_COPY (it owns only the VA_RTT_CHANNEL buffer)"
+#endif
+#if (VA_ROUTE_TASK > 31) || (VA_ROUTE_ISR > 31) || (VA_ROUTE_SYNC > 31) || \
+    (VA_ROUTE_USER > 31) || (VA_ROUTE_LOG > 31) || (VA_ROUTE_SYSTEM > 31)
+#error "VA_ROUTE_<class> must be an ITM stimulus port / RTT channel in 0..31"
+#endif
+static const uint8_t s_va_route[VA_CLASS_COUNT] = {
+    VA_ROUTE_TASK, VA_ROUTE_ISR, VA_ROUTE_SYNC, VA_ROUTE_USER, VA_ROUTE_LOG, VA_ROUTE_SYSTEM,
+};
+
+static inline uint32_t _va_route(uint8_t type_byte)
+{
+    return s_va_route[_va_packet_class(type_byte)];
+}
+
+/* Bit n set: some class goes to port / channel n */
+static inline uint32_t _va_route_mask(void)
+{
+    uint32_t mask = 0;
+    for (uint32_t c = 0; c < VA_CLASS_COUNT; ++c)
+        mask |= 1UL << s_va_route[c];
+    return mask;
+}
+#else
+#define _va_route(type_byte) ((uint32_t)VA_ROUTE_MAIN)
+#endif
+
+/* ================================================================
+ *  Loss accounting
+ *
+ *  Paths that drop packets instead of waiting (the non-blocking ITM port,
+ *  the ring buffer with priority shedding) count the drops per class and
+ *  put a VA_EVENT_LOSS packet in front of the next packet that gets
+ *  through, so the host can mark the gap where it happened.
+ * ================================================================ */
+#define VA_LOSS_REPORTS ((VA_TRANSPORT_IS_ITM && VA_ITM_NONBLOCKING) || \
+                         (VA_USE_RING_BUFFER && VA_PRIORITY_SHEDDING))
+
+#if VA_LOSS_REPORTS
+/* [0x18][0][first loss 8B][events 4B][bytes 4B][n][n x class events 2B] */
+#define VA_LOSS_PACKET_SIZE (19u + 2u * (uint32_t)VA_CLASS_COUNT)
+
+/* Losses since the last report, plus running totals */
+typedef struct
+{
+    uint32_t events;
+    uint32_t bytes;
+    uint16_t class_events[VA_CLASS_COUNT];   /* saturating */
+    uint64_t since;                          /* timestamp of the first loss */
+    uint32_t total_events[VA_CLASS_COUNT];
+    uint32_t total_bytes[VA_CLASS_COUNT];
+} VA_Loss_t;
+
+/* Time anchors count like any other packet: a cut anchor still leaves
+ * bytes on the port that the next loss report has to resynchronise. */
+static void _va_loss_count(VA_Loss_t *loss, uint8_t type_byte, uint32_t length)
+{
+    uint8_t cls = _va_packet_class(type_byte);
+    if (loss->events == 0)
+    {
+        loss->since = _va_get_timestamp();
+    }
+    loss->events++;
+    loss->bytes += length;
+    if (loss->class_events[cls] != 0xFFFFu)
+    {
+        loss->class_events[cls]++;
+    }
+    loss->total_events[cls]++;
+    loss->total_bytes[cls] += length;
+}
+
+/* Built by hand, not through _va_put_timestamp(): the first-loss time is
+ * always absolute and sending it must not touch the delta chain. */
+static uint32_t _va_loss_build(const VA_Loss_t *loss, uint8_t *packet)
+{
+    uint32_t n = 0;
+    packet[n++] = VA_EVENT_LOSS;
+    packet[n++] = 0;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        packet[n++] = (uint8_t)(loss->since >> (8 * i));
+    }
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        packet[n++] = (uint8_t)(loss->events >> (8 * i));
+    }
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        packet[n++] = (uint8_t)(loss->bytes >> (8 * i));
+    }
+    packet[n++] = VA_CLASS_COUNT;
+    for (uint32_t c = 0; c < VA_CLASS_COUNT; ++c)
+    {
+        packet[n++] = (uint8_t)(loss->class_events[c] >> 0);
+        packet[n++] = (uint8_t)(loss->class_events[c] >> 8);
+    }
+    return n;
+}
+
+static void _va_loss_reported(VA_Loss_t *loss)
+{
+    loss->events = 0;
+    loss->bytes = 0;
+    memset(loss->class_events, 0, sizeof(loss->class_events));
+}
+#endif /* VA_LOSS_REPORTS */
+
 /* ================================================================
  *  Transport layer
  * ================================================================ */
 
+#if VA_TRANSPORT_IS_FRAMED && VA_USE_RING_BUFFER
+/* Space VA_Drain() wants downstream before it takes a record out of the
+ * ring, for transports that push back (_va_transport_fits). */
+static inline uint32_t _va_drain_need(uint32_t length)
+{
+#if VA_COMPRESS
+    /* The record may close the open frame, and VA_Drain() flushes the next */
+    VA_UNUSED(length);
+    return 2u * (uint32_t)va_cobs_max_encoded_len(VA_COMPRESS_FRAME_BYTES);
+#else
+    return (uint32_t)va_cobs_max_encoded_len(length);
+#endif
+}
+#endif
+
 #if VA_TRANSPORT_IS_ITM
+/* With routing the debugger filters classes through ITM->TER: a packet for
+ * a disabled port is skipped instead of written (and waited on). */
+#if VA_ROUTE_BY_CLASS
+#define _va_itm_port_on(port) (((ITM->TER >> (port)) & 1u) != 0u)
+#else
+#define _va_itm_port_on(port) (true)
+#endif
+
+#if VA_ITM_NONBLOCKING
+#if VA_USE_RING_BUFFER
+#error "VA_ITM_NONBLOCKING is for direct ITM output: with VA_USE_RING_BUFFER the hooks never wait on the port"
+#endif
+
+/* Poll the stimulus port at most VA_ITM_SPIN_LIMIT times */
+static inline bool _va_itm_wait(uint32_t port)
+{
+    for (uint32_t spins = 0; spins < VA_ITM_SPIN_LIMIT; ++spins)
+    {
+        if (ITM->PORT[port].u32 != 0)
+            return true;
+    }
+    return false;
+}
+
+/* Write one packet without waiting on a full port.  Nothing is written
+ * unless the port can take the first word right away; after that each
+ * word waits at most VA_ITM_SPIN_LIMIT polls.  Returns the bytes written,
+ * so 0 is a clean drop and anything short of `length` a cut packet. */
+static uint32_t _va_itm_try_write(uint32_t port, const uint8_t *data, uint32_t length)
+{
+    uint32_t i = 0;
+    if (ITM->PORT[port].u32 == 0)
+        return 0;
+    while (length - i >= 4)
+    {
+        if (i != 0 && !_va_itm_wait(port))
+            return i;
+        uint32_t word = ((uint32_t)data[i + 3] << 24) |
+                        ((uint32_t)data[i + 2] << 16) |
+                        ((uint32_t)data[i + 1] << 8) |
+                        ((uint32_t)data[i + 0] << 0);
+        ITM->PORT[port].u32 = word;
+        i += 4;
+    }
+    while (i < length)
+    {
+        if (i != 0 && !_va_itm_wait(port))
+            return i;
+        ITM->PORT[port].u8 = data[i];
+        i++;
+    }
+    return i;
+}
+
+static VA_Loss_t s_va_itm_loss;
+static uint32_t  s_va_itm_resync;   /* bit n: a packet on port n was cut, sync marker first */
+
+static void _va_itm_count_loss(const uint8_t *data, uint32_t length)
+{
+#if VA_COMPACT_TIMESTAMPS
+    _va_ts_resync = true;   /* the host's delta chain is broken */
+#endif
+    _va_loss_count(&s_va_itm_loss, data[0], length);
+}
+
+static bool _va_itm_report_loss(void)
+{
+    uint8_t packet[VA_LOSS_PACKET_SIZE];
+    uint32_t n, written;
+
+    for (uint32_t port = 0; s_va_itm_resync != 0u; ++port)
+    {
+        if ((s_va_itm_resync & (1u << port)) == 0u)
+            continue;
+        if (_va_itm_try_write(port, VA_SYNC_MARKER, sizeof(VA_SYNC_MARKER)) != sizeof(VA_SYNC_MARKER))
+            return false;
+        s_va_itm_resync &= ~(1u << port);
+    }
+
+    n = _va_loss_build(&s_va_itm_loss, packet);
+    uint32_t port = _va_route(VA_EVENT_LOSS);
+    written = _va_itm_try_write(port, packet, n);
+    if (written != n)
+    {
+        if (written != 0)
+            s_va_itm_resync |= 1u << port;
+        return false;
+    }
+    _va_loss_reported(&s_va_itm_loss);
+    return true;
+}
+
+/* A pending loss report goes out before the next packet, so the host sees
+ * the gap where it happened.  If the port is still busy, the packet joins
+ * the gap. */
+static void _va_send_bytes(const uint8_t *data, uint32_t length)
+{
+    if (!VA_IS_INIT || length == 0)
+        return;
+    uint32_t port = _va_route(data[0]);
+    if (!_va_itm_port_on(port))
+        return;
+    if (s_va_itm_loss.events != 0 && !_va_itm_report_loss())
+    {
+        _va_itm_count_loss(data, length);
+        return;
+    }
+    uint32_t written = _va_itm_try_write(port, data, length);
+    if (written != length)
+    {
+        if (written != 0)
+            s_va_itm_resync |= 1u << port;
+        _va_itm_count_loss(data, length);
+    }
+}
+
+#else
 #define ITM_WaitReady(port) while (ITM->PORT[port].u32 == 0)
 
 static inline void ITM_SendU32(uint8_t port, uint32_t value)
@@ -196,7 +614,10 @@ static inline void ITM_SendU8(uint8_t port, uint8_t value)
 }
 static void _va_send_bytes(const uint8_t *data, uint32_t length)
 {
-    if (!VA_IS_INIT)
+    if (!VA_IS_INIT || length == 0)
+        return;
+    uint8_t port = (uint8_t)_va_route(data[0]);
+    if (!_va_itm_port_on(port))
         return;
     uint32_t i = 0;
     while (length >= 4)
@@ -205,25 +626,112 @@ static void _va_send_bytes(const uint8_t *data, uint32_t length)
                         ((uint32_t)data[i + 2] << 16) |
                         ((uint32_t)data[i + 1] << 8) |
                         ((uint32_t)data[i + 0] << 0);
-        ITM_SendU32(VA_ITM_PORT, word);
+        ITM_SendU32(port, word);
         i += 4;
         length -= 4;
     }
     while (length > 0)
     {
-        ITM_SendU8(VA_ITM_PORT, data[i]);
+        ITM_SendU8(port, data[i]);
         i++;
         length--;
     }
 }
+#endif /* VA_ITM_NONBLOCKING */
 
 #elif VA_TRANSPORT_IS_JLINK
-static void _va_send_bytes(const uint8_t *data, uint32_t length)
+#if VA_RTT_ZERO_COPY
+/* ================================================================
+ *  Zero-copy RTT
+ *
+ *  Packets go straight into s_va_rtt_up_buffer and WrOff is published
+ *  once, after a DMB, so the probe never sees a partial packet.  The
+ *  recorder is the only producer on its channel: with the ring buffer
+ *  that is VA_Drain(), otherwise the hook that holds VA_CS_ENTER() —
+ *  the same assumption the ITM backend makes for a multi-word packet.
+ *  SEGGER's lock is only taken when the recorder may not mask interrupts.
+ * ================================================================ */
+#if (VA_CONFIGURE_RTT != 1) || !(VA_RTT_BUFFER_SIZE > 0)
+#error "VA_RTT_ZERO_COPY needs VA_CONFIGURE_RTT=1 and VA_RTT_BUFFER_SIZE > 0: the recorder must own the up-buffer"
+#endif
+#if defined(SEGGER_RTT_CPU_CACHE_LINE_SIZE) && SEGGER_RTT_CPU_CACHE_LINE_SIZE
+#error "VA_RTT_ZERO_COPY does not support a cached RTT control block (SEGGER_RTT_CPU_CACHE_LINE_SIZE)"
+#endif
+
+#if VA_USE_RING_BUFFER || VA_ALLOWED_TO_DISABLE_INTERRUPTS
+#define VA_RTT_LOCK()   ((void)0)
+#define VA_RTT_UNLOCK() ((void)0)
+#else
+#define VA_RTT_LOCK()   SEGGER_RTT_LOCK()
+#define VA_RTT_UNLOCK() SEGGER_RTT_UNLOCK()
+#endif
+
+/* Free bytes after WrOff `wr`, waiting for the host in blocking mode (RTT
+ * keeps one byte empty to tell full from empty) */
+static inline uint32_t _va_rtt_room(uint32_t wr, uint32_t need)
+{
+    uint32_t room;
+    do
+    {
+        uint32_t rd = _SEGGER_RTT.aUp[VA_RTT_CHANNEL].RdOff;
+        room = (rd > wr) ? (rd - wr - 1u) : (VA_RTT_BUFFER_SIZE - (wr - rd) - 1u);
+    } while (room < need && VA_RTT_MODE == SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL);
+    return room;
+}
+
+/* `length` contiguous bytes at WrOff, or NULL if the packet would wrap or
+ * does not fit — then send it with _va_rtt_write() instead.  Must be
+ * followed by _va_rtt_commit() with no other write in between. */
+uint8_t *_va_rtt_reserve(uint32_t length)
+{
+    uint32_t wr = _SEGGER_RTT.aUp[VA_RTT_CHANNEL].WrOff;
+    if (!VA_IS_INIT || wr + length > VA_RTT_BUFFER_SIZE || _va_rtt_room(wr, length) < length)
+        return NULL;
+    return &s_va_rtt_up_buffer[wr];
+}
+
+void _va_rtt_commit(uint8_t *payload, uint32_t length)
+{
+    uint32_t wr = (uint32_t)(payload - s_va_rtt_up_buffer) + length;
+    __DMB();
+    _SEGGER_RTT.aUp[VA_RTT_CHANNEL].WrOff = (wr == VA_RTT_BUFFER_SIZE) ? 0u : wr;
+}
+
+/* One copy into the up-buffer, split at the wrap */
+void _va_rtt_write(const uint8_t *data, uint32_t length)
 {
     if (!VA_IS_INIT)
         return;
-    SEGGER_RTT_Write(VA_RTT_CHANNEL, data, length);
+    VA_RTT_LOCK();
+    uint32_t wr = _SEGGER_RTT.aUp[VA_RTT_CHANNEL].WrOff;
+    if (_va_rtt_room(wr, length) >= length)
+    {
+        uint32_t first = VA_RTT_BUFFER_SIZE - wr;
+        if (first > length)
+            first = length;
+        memcpy(&s_va_rtt_up_buffer[wr], data, first);
+        memcpy(s_va_rtt_up_buffer, data + first, length - first);
+        wr += length;
+        if (wr >= VA_RTT_BUFFER_SIZE)
+            wr -= VA_RTT_BUFFER_SIZE;
+        __DMB();
+        _SEGGER_RTT.aUp[VA_RTT_CHANNEL].WrOff = wr;
+    }
+    VA_RTT_UNLOCK();
+}
+
+static inline void _va_send_bytes(const uint8_t *data, uint32_t length)
+{
+    _va_rtt_write(data, length);
+}
+#else
+static void _va_send_bytes(const uint8_t *data, uint32_t length)
+{
+    if (!VA_IS_INIT || length == 0)
+        return;
+    SEGGER_RTT_Write(_va_route(data[0]), data, length);
 }
+#endif /* VA_RTT_ZERO_COPY */
 
 #elif VA_TRANSPORT_IS_CUSTOM
 static void _va_send_bytes(const uint8_t *data, uint32_t length)
@@ -233,48 +741,1593 @@ static void _va_send_bytes(const uint8_t *data, uint32_t length)
     s_user_send_fn(data, length);
 }
 
+#elif VA_TRANSPORT_IS_UART_DMA
+/* ================================================================
+ *  UART DMA transport
+ *
+ *  COBS frames are appended to the half of s_va_uart_buf being filled
+ *  while the DMA engine sends the other half.  VA_UartDmaTxComplete(),
+ *  called from the DMA-complete interrupt, hands over the filled half, so
+ *  one transfer carries every packet queued during the previous one and
+ *  the CPU never waits on the UART.  Without the ring buffer an idle
+ *  engine is started right after each packet; with it VA_Drain() starts it
+ *  once per call and leaves packets in the ring while the buffer is full.
+ *
+ *  The swap runs in the DMA interrupt, so the buffer state is only touched
+ *  with interrupts masked.
+ * ================================================================ */
+#if !VA_ALLOWED_TO_DISABLE_INTERRUPTS
+#error "UART_DMA_TRANSPORT needs VA_ALLOWED_TO_DISABLE_INTERRUPTS=1 (the DMA-complete interrupt swaps the buffers)"
+#endif
+#if VA_NUM_CORES > 1
+#error "UART_DMA_TRANSPORT supports a single core only"
+#endif
+#if (VA_UART_DMA_BUFFER_SIZE) < (VA_MAX_PACKET_SIZE) + ((VA_MAX_PACKET_SIZE) / 254) + 2
+#error "VA_UART_DMA_BUFFER_SIZE must hold one maximum-size COBS frame"
+#endif
+
+static VA_UartDmaStartFn s_va_uart_start = NULL;
+static uint8_t           s_va_uart_buf[2][VA_UART_DMA_BUFFER_SIZE] VA_UART_DMA_BUFFER_ATTR;
+static struct
+{
+    uint32_t fill;      /* bytes queued in s_va_uart_buf[active] */
+    uint8_t  active;    /* half being filled; the other may be in flight */
+    bool     busy;      /* a transfer is in flight */
+    uint32_t dropped;
+} s_va_uart;
+
+/* Start the engine on the filled half if it is idle.  Interrupts masked.
+ * The state is updated first: the start function may complete at once. */
+static void _va_uart_kick(void)
+{
+    if (s_va_uart.busy || s_va_uart.fill == 0u)
+        return;
+    const uint8_t *half = s_va_uart_buf[s_va_uart.active];
+    uint32_t length = s_va_uart.fill;
+    s_va_uart.busy = true;
+    s_va_uart.active ^= 1u;
+    s_va_uart.fill = 0;
+    s_va_uart_start(half, length);
+}
+
+/* Room for `need` bytes in the filling half, or NULL (counted as a drop).
+ * Interrupts masked. */
+static uint8_t *_va_uart_claim(uint32_t need)
+{
+    if (s_va_uart.fill + need > VA_UART_DMA_BUFFER_SIZE)
+        _va_uart_kick();
+    if (s_va_uart.fill + need > VA_UART_DMA_BUFFER_SIZE)
+    {
+        s_va_uart.dropped++;
+        return NULL;
+    }
+    return &s_va_uart_buf[s_va_uart.active][s_va_uart.fill];
+}
+
+static void _va_uart_queued(uint32_t length)
+{
+    s_va_uart.fill += length;
+#if !VA_USE_RING_BUFFER
+    _va_uart_kick();
+#endif
+}
+
+#if !VA_COMPRESS
+/* COBS-encode one packet straight into the DMA buffer */
+static void _va_uart_packet(const uint8_t *data, uint32_t length)
+{
+    if (!VA_IS_INIT || s_va_uart_start == NULL)
+        return;
+    VA_CS_ENTER();
+    uint8_t *dst = _va_uart_claim((uint32_t)va_cobs_max_encoded_len(length));
+    if (dst != NULL)
+        _va_uart_queued((uint32_t)va_cobs_encode(data, (size_t)length, dst));
+    VA_CS_EXIT();
+}
 #else
-#error "VA_TRANSPORT must be ARM_ITM, JLINK_RTT, or CUSTOM_TRANSPORT"
-#endif // VA_TRANSPORT
+/* Already framed bytes (compressed frames) */
+static void _va_send_bytes(const uint8_t *data, uint32_t length)
+{
+    if (!VA_IS_INIT || s_va_uart_start == NULL)
+        return;
+    VA_CS_ENTER();
+    uint8_t *dst = _va_uart_claim(length);
+    if (dst != NULL)
+    {
+        memcpy(dst, data, length);
+        _va_uart_queued(length);
+    }
+    VA_CS_EXIT();
+}
+#endif
+
+#if VA_USE_RING_BUFFER
+/* True if a record of `length` bytes can leave the ring now */
+static bool _va_transport_fits(uint32_t length)
+{
+    uint32_t need = _va_drain_need(length);
+    VA_CS_ENTER();
+    if (s_va_uart.fill + need > VA_UART_DMA_BUFFER_SIZE)
+        _va_uart_kick();
+    bool fits = (s_va_uart.fill + need <= VA_UART_DMA_BUFFER_SIZE);
+    VA_CS_EXIT();
+    return fits;
+}
+
+static void _va_transport_flush(void)
+{
+    VA_CS_ENTER();
+    _va_uart_kick();
+    VA_CS_EXIT();
+}
+#endif
+
+void VA_UartDmaTxComplete(void)
+{
+    VA_CS_ENTER();
+    s_va_uart.busy = false;
+    _va_uart_kick();
+    VA_CS_EXIT();
+}
 
+#elif VA_TRANSPORT_IS_LWIP_UDP
 /* ================================================================
- *  Packet emission layer
+ *  lwIP UDP transport
+ *
+ *  VA_Drain() COBS-encodes packets straight into the payload of a PBUF_RAM
+ *  pbuf allocated with room for the UDP/IP headers, and hands it to
+ *  udp_send() once the next frame would pass VA_LWIP_DATAGRAM_BYTES and at
+ *  the end of every drain.  lwIP prepends its headers in place, so a packet
+ *  is copied once, from the ring into the datagram.
+ *
+ *  The raw API is not thread safe: only VA_Drain() touches lwIP, and it
+ *  must run in lwIP's context (NO_SYS main loop, tcpip thread, or under
+ *  LOCK_TCPIP_CORE()).  The hooks only fill the ring.
  * ================================================================ */
-static inline void _va_emit_packet_raw(const uint8_t *data, uint32_t length)
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+#if !VA_USE_RING_BUFFER
+#error "LWIP_UDP_TRANSPORT needs VA_USE_RING_BUFFER: lwIP may only be called from VA_Drain()"
+#endif
+#if (VA_LWIP_DATAGRAM_BYTES) < (VA_MAX_PACKET_SIZE) + ((VA_MAX_PACKET_SIZE) / 254) + 2
+#error "VA_LWIP_DATAGRAM_BYTES must hold one maximum-size COBS frame"
+#endif
+#if (VA_LWIP_DATAGRAM_BYTES) > 0xFFFFu
+#error "VA_LWIP_DATAGRAM_BYTES must fit a pbuf length"
+#endif
+
+static struct udp_pcb *s_va_lwip_pcb = NULL;
+static struct
 {
-#if VA_TRANSPORT_IS_CUSTOM
-    uint8_t cobs_buf[VA_MAX_PACKET_SIZE + (VA_MAX_PACKET_SIZE / 254) + 2];
-    size_t encoded_len = va_cobs_encode(data, (size_t)length, cobs_buf);
-    _va_send_bytes(cobs_buf, (uint32_t)encoded_len);
+    struct pbuf *p;         /* datagram being filled, NULL = none */
+    uint32_t     fill;      /* bytes used in p */
+    uint32_t     packets;   /* frames in p, counted as dropped if the send fails */
+    uint32_t     dropped;
+} s_va_lwip;
+
+static void _va_transport_flush(void)
+{
+    struct pbuf *p = s_va_lwip.p;
+    if (p == NULL)
+        return;
+    s_va_lwip.p = NULL;
+    if (s_va_lwip.fill != 0u)
+    {
+        pbuf_realloc(p, (u16_t)s_va_lwip.fill);
+        if (udp_send(s_va_lwip_pcb, p) != ERR_OK)
+            s_va_lwip.dropped += s_va_lwip.packets;
+    }
+    pbuf_free(p);
+}
+
+/* Room for `need` bytes in the open datagram, sending it and starting a
+ * new one if needed.  NULL if lwIP is out of pbuf memory. */
+static uint8_t *_va_lwip_claim(uint32_t need)
+{
+    if (s_va_lwip.p != NULL && s_va_lwip.fill + need > VA_LWIP_DATAGRAM_BYTES)
+        _va_transport_flush();
+    if (s_va_lwip.p == NULL)
+    {
+        s_va_lwip.p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)VA_LWIP_DATAGRAM_BYTES, PBUF_RAM);
+        if (s_va_lwip.p == NULL)
+            return NULL;
+        s_va_lwip.fill = 0;
+        s_va_lwip.packets = 0;
+    }
+    return (uint8_t *)s_va_lwip.p->payload + s_va_lwip.fill;
+}
+
+static void _va_lwip_queued(uint32_t length)
+{
+    s_va_lwip.fill += length;
+    s_va_lwip.packets++;
+}
+
+#if !VA_COMPRESS
+/* COBS-encode one packet straight into the datagram */
+static void _va_lwip_packet(const uint8_t *data, uint32_t length)
+{
+    if (!VA_IS_INIT || s_va_lwip_pcb == NULL)
+        return;
+    uint8_t *dst = _va_lwip_claim((uint32_t)va_cobs_max_encoded_len(length));
+    if (dst == NULL)
+    {
+        s_va_lwip.dropped++;
+        return;
+    }
+    _va_lwip_queued((uint32_t)va_cobs_encode(data, (size_t)length, dst));
+}
+#else
+/* Already framed bytes (compressed frames) */
+static void _va_send_bytes(const uint8_t *data, uint32_t length)
+{
+    if (!VA_IS_INIT || s_va_lwip_pcb == NULL)
+        return;
+    uint8_t *dst = _va_lwip_claim(length);
+    if (dst == NULL)
+    {
+        s_va_lwip.dropped++;
+        return;
+    }
+    memcpy(dst, data, length);
+    _va_lwip_queued(length);
+}
+#endif
+
+/* Records stay in the ring while lwIP is out of pbuf memory */
+static bool _va_transport_fits(uint32_t length)
+{
+    if (s_va_lwip_pcb == NULL)
+        return true;   /* not connected yet: drain and discard */
+    return _va_lwip_claim(_va_drain_need(length)) != NULL;
+}
+
+#if VA_REMOTE_CONTROL
+static void _va_lwip_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    VA_UNUSED(arg);
+    VA_UNUSED(pcb);
+    VA_UNUSED(addr);
+    VA_UNUSED(port);
+    for (struct pbuf *q = p; q != NULL; q = q->next)
+    {
+        VA_ReceiveCommandBytes((const uint8_t *)q->payload, q->len);
+    }
+    pbuf_free(p);
+}
+#endif
+
+#else
+#error "VA_TRANSPORT must be ARM_ITM, JLINK_RTT, CUSTOM_TRANSPORT, UART_DMA_TRANSPORT or LWIP_UDP_TRANSPORT"
+#endif // VA_TRANSPORT
+
+/* ================================================================
+ *  Packet emission layer
+ * ================================================================ */
+#if VA_COMPRESS
+/* ================================================================
+ *  Stream compression (VA_COMPRESS)
+ *
+ *  LZSS over the concatenation of [LEB128 length][packet] records, with
+ *  the history kept across frames.  Tokens are packed MSB first:
+ *    1 + 8-bit literal
+ *    0 + (distance - 1) in VA_COMPRESS_WINDOW_BITS + (length - 3) in 4 bits
+ *  Matches are found through a single-entry hash of the next three bytes
+ *  and verified byte by byte, so a stale table entry only costs a miss.
+ *  Every VA_COMPRESS_RESYNC_BYTES of input the next frame restarts the
+ *  history (reset bit set), so a host that lost a frame — seen as a gap in
+ *  the 7-bit sequence — picks the stream up again from there.
+ *
+ *  Only VA_Drain() feeds the compressor (it is the single consumer), and it
+ *  flushes the open frame before returning.
+ * ================================================================ */
+#if !VA_TRANSPORT_IS_FRAMED
+#error "VA_COMPRESS is only supported with CUSTOM_TRANSPORT, UART_DMA_TRANSPORT or LWIP_UDP_TRANSPORT"
+#endif
+#if VA_TRANSPORT_IS_UART_DMA && (VA_UART_DMA_BUFFER_SIZE) < 2u * ((VA_COMPRESS_FRAME_BYTES) + ((VA_COMPRESS_FRAME_BYTES) / 254u) + 2u)
+#error "VA_UART_DMA_BUFFER_SIZE must hold two COBS-framed VA_COMPRESS_FRAME_BYTES frames"
+#endif
+#if VA_TRANSPORT_IS_LWIP_UDP && (VA_LWIP_DATAGRAM_BYTES) < 2u * ((VA_COMPRESS_FRAME_BYTES) + ((VA_COMPRESS_FRAME_BYTES) / 254u) + 2u)
+#error "VA_LWIP_DATAGRAM_BYTES must hold two COBS-framed VA_COMPRESS_FRAME_BYTES frames"
+#endif
+#if !VA_USE_RING_BUFFER
+#error "VA_COMPRESS needs VA_USE_RING_BUFFER: packets are batched into frames by VA_Drain()"
+#endif
+#if (VA_COMPRESS_WINDOW_BITS) < 8 || (VA_COMPRESS_WINDOW_BITS) > 14
+#error "VA_COMPRESS_WINDOW_BITS must be between 8 and 14"
+#endif
+#if (VA_COMPRESS_FRAME_BYTES) < 3u + (9u * ((VA_MAX_PACKET_SIZE) + 2u) + 7u) / 8u
+#error "VA_COMPRESS_FRAME_BYTES must hold one maximum-size packet stored as literals"
+#endif
+
+#define VA_LZ_WINDOW    (1u << (VA_COMPRESS_WINDOW_BITS))
+#define VA_LZ_LEN_BITS  4u
+#define VA_LZ_MIN_MATCH 3u
+#define VA_LZ_MAX_MATCH (VA_LZ_MIN_MATCH + (1u << VA_LZ_LEN_BITS) - 1u)
+#define VA_LZ_HASH_BITS 9u
+
+static struct
+{
+    uint8_t  hist[VA_LZ_WINDOW];                    /* last bytes fed, indexed by pos */
+    uint16_t head[1u << VA_LZ_HASH_BITS];           /* (pos + 1) of the last 3-byte prefix, 0 = none */
+    uint8_t  frame[VA_COMPRESS_FRAME_BYTES];
+    uint8_t  cobs[VA_COMPRESS_FRAME_BYTES + (VA_COMPRESS_FRAME_BYTES / 254) + 2];
+    uint32_t pos;                                   /* bytes fed since the last history reset */
+    uint32_t bits;                                  /* bits used in frame, 0 = no open frame */
+    uint8_t  seq;
+    bool     restart;                               /* next frame resets the history */
+} s_va_lz;
+
+static void _va_lz_reset(void)
+{
+    s_va_lz.bits = 0;
+    s_va_lz.seq = 0;
+    s_va_lz.restart = true;
+}
+
+static inline uint32_t _va_lz_hash(const uint8_t *p)
+{
+    return ((((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2]) * 2654435761u) >> (32u - VA_LZ_HASH_BITS);
+}
+
+static void _va_lz_put(uint32_t value, uint32_t nbits)
+{
+    while (nbits > 0u)
+    {
+        uint32_t used = s_va_lz.bits & 7u;
+        uint32_t take = 8u - used;
+        if (take > nbits)
+            take = nbits;
+        uint32_t chunk = (value >> (nbits - take)) & ((1u << take) - 1u);
+        uint8_t *b = &s_va_lz.frame[s_va_lz.bits >> 3];
+        if (used == 0u)
+            *b = 0;
+        *b |= (uint8_t)(chunk << (8u - used - take));
+        s_va_lz.bits += take;
+        nbits -= take;
+    }
+}
+
+static void _va_lz_flush(void)
+{
+    if (s_va_lz.bits == 0u)
+        return;
+    size_t encoded_len = va_cobs_encode(s_va_lz.frame, (size_t)((s_va_lz.bits + 7u) >> 3), s_va_lz.cobs);
+    _va_send_bytes(s_va_lz.cobs, (uint32_t)encoded_len);
+    s_va_lz.bits = 0;
+    s_va_lz.seq = (uint8_t)((s_va_lz.seq + 1u) & 0x7Fu);
+}
+
+/* Compress `n` bytes into the open frame; the caller has checked that
+ * they fit even as literals. */
+static void _va_lz_feed(const uint8_t *in, uint32_t n)
+{
+    const uint32_t mask = VA_LZ_WINDOW - 1u;
+    uint32_t i = 0;
+    while (i < n)
+    {
+        uint32_t pos = s_va_lz.pos;
+        uint32_t best = 0;
+        uint32_t dist = 0;
+        if (n - i >= VA_LZ_MIN_MATCH)
+        {
+            uint32_t h = _va_lz_hash(&in[i]);
+            dist = (uint16_t)(pos + 1u - s_va_lz.head[h]);
+            if (s_va_lz.head[h] != 0u && dist != 0u && dist <= VA_LZ_WINDOW && dist <= pos)
+            {
+                uint32_t max = n - i;
+                if (max > VA_LZ_MAX_MATCH)
+                    max = VA_LZ_MAX_MATCH;
+                /* The source may run into this call's own input */
+                while (best < max &&
+                       ((best < dist) ? s_va_lz.hist[(pos - dist + best) & mask] : in[i + best - dist]) == in[i + best])
+                {
+                    ++best;
+                }
+            }
+        }
+        if (best < VA_LZ_MIN_MATCH)
+        {
+            best = 1;
+            _va_lz_put(0x100u | in[i], 9u);
+        }
+        else
+        {
+            _va_lz_put(((dist - 1u) << VA_LZ_LEN_BITS) | (best - VA_LZ_MIN_MATCH), 1u + VA_COMPRESS_WINDOW_BITS + VA_LZ_LEN_BITS);
+        }
+        for (uint32_t k = 0; k < best; ++k, ++i)
+        {
+            if (n - i >= VA_LZ_MIN_MATCH)
+                s_va_lz.head[_va_lz_hash(&in[i])] = (uint16_t)(s_va_lz.pos + 1u);
+            s_va_lz.hist[s_va_lz.pos & mask] = in[i];
+            ++s_va_lz.pos;
+        }
+    }
+}
+
+static void _va_lz_packet(const uint8_t *data, uint32_t length)
+{
+    /* One contiguous record, so matches can span the length prefix */
+    uint8_t rec[2u + VA_MAX_PACKET_SIZE];
+    uint32_t n = 1;
+    if (length > VA_MAX_PACKET_SIZE)
+        return;
+    rec[0] = (uint8_t)length;
+    if (length > 0x7Fu)
+    {
+        rec[0] |= 0x80u;
+        rec[1] = (uint8_t)(length >> 7);
+        n = 2;
+    }
+    memcpy(&rec[n], data, length);
+    n += length;
+
+    /* Worst case every byte is a literal (9 bits) */
+    if (s_va_lz.bits != 0u && s_va_lz.bits + 9u * n > 8u * VA_COMPRESS_FRAME_BYTES)
+        _va_lz_flush();
+
+    if (s_va_lz.bits == 0u)
+    {
+        if (s_va_lz.pos >= VA_COMPRESS_RESYNC_BYTES)
+            s_va_lz.restart = true;
+        s_va_lz.frame[0] = VA_FRAME_COMPRESSED;
+        s_va_lz.frame[1] = s_va_lz.seq;
+        s_va_lz.bits = 16;
+        if (s_va_lz.restart)
+        {
+            s_va_lz.restart = false;
+            s_va_lz.pos = 0;
+            s_va_lz.frame[1] |= 0x80u;
+            s_va_lz.frame[2] = (uint8_t)(((VA_COMPRESS_WINDOW_BITS - 8u) << 4) | VA_LZ_LEN_BITS);
+            s_va_lz.bits = 24;
+        }
+    }
+
+    _va_lz_feed(rec, n);
+}
+#endif /* VA_COMPRESS */
+
+static inline void _va_emit_packet_raw(const uint8_t *data, uint32_t length)
+{
+#if VA_COMPRESS
+    _va_lz_packet(data, length);
+#elif VA_TRANSPORT_IS_UART_DMA
+    _va_uart_packet(data, length);
+#elif VA_TRANSPORT_IS_LWIP_UDP
+    _va_lwip_packet(data, length);
+#elif VA_TRANSPORT_IS_CUSTOM
+    uint8_t cobs_buf[VA_MAX_PACKET_SIZE + (VA_MAX_PACKET_SIZE / 254) + 2];
+    size_t encoded_len = va_cobs_encode(data, (size_t)length, cobs_buf);
+    _va_send_bytes(cobs_buf, (uint32_t)encoded_len);
+#else
+    _va_send_bytes(data, length);
+#endif
+}
+
+/* ================================================================
+ *  Extra sinks (VA_SINKS)
+ *
+ *  VA_Drain() hands each packet it sends to the transport to every sink
+ *  whose class mask has the packet's class, as a pointer into the ring
+ *  record: the packet is built once, however many sinks take it.  A sink
+ *  with a byte budget (token bucket, refilled once per VA_Drain() call)
+ *  skips packets while the budget is spent and counts them.  Sinks never
+ *  hold the drain back; the transport still paces it.
+ * ================================================================ */
+#if VA_SINKS
+#if !VA_USE_RING_BUFFER
+#error "VA_SINKS needs VA_USE_RING_BUFFER: sinks are fed by VA_Drain()"
+#endif
+#if VA_FLIGHT_RECORDER
+#error "VA_SINKS cannot be combined with VA_FLIGHT_RECORDER (a VA_RamSink_t keeps the post-mortem window instead)"
+#endif
+#if VA_COMPACT_TIMESTAMPS
+#error "VA_SINKS cannot be combined with VA_COMPACT_TIMESTAMPS (a sink that skips packets breaks the delta chain)"
+#endif
+
+typedef struct
+{
+    VA_SinkFn fn;           /* NULL = free slot */
+    void     *ctx;
+    uint32_t  class_mask;
+    uint32_t  rate;         /* bytes per second, 0 = no budget */
+    uint32_t  burst;
+    uint32_t  tokens;
+    uint64_t  refilled;     /* timestamp of the last refill */
+    uint32_t  dropped;
+} VA_SinkEntry_t;
+
+static VA_SinkEntry_t s_va_sinks[VA_MAX_SINKS];
+
+static void _va_sinks_refill(void)
+{
+    if (_va_cpu_freq == 0u)
+        return;
+    uint64_t now = _va_get_timestamp();
+    for (uint32_t i = 0; i < VA_MAX_SINKS; ++i)
+    {
+        VA_SinkEntry_t *s = &s_va_sinks[i];
+        if (s->fn == NULL || s->rate == 0u)
+            continue;
+        uint64_t elapsed = now - s->refilled;
+        bool     stale = elapsed > 0xFFFFFFFFu;
+        if (stale)
+            elapsed = 0xFFFFFFFFu;
+        uint64_t add = (elapsed * s->rate) / _va_cpu_freq;
+        if (add == 0u)
+            continue; /* keep the fraction for the next call */
+        uint64_t tokens = (uint64_t)s->tokens + add;
+        if (tokens >= s->burst || stale)
+        {
+            /* a full bucket has nothing to carry over */
+            s->tokens = (tokens > s->burst) ? s->burst : (uint32_t)tokens;
+            s->refilled = now;
+        }
+        else
+        {
+            /* advance only by the time the tokens stand for, so the
+             * rounded-off fraction counts towards the next refill */
+            s->tokens = (uint32_t)tokens;
+            s->refilled += (add * _va_cpu_freq) / s->rate;
+        }
+    }
+}
+
+static void _va_sinks_packet(const uint8_t *data, uint32_t length)
+{
+    uint32_t bit = VA_CLASS_BIT(_va_packet_class(data[0]));
+    for (uint32_t i = 0; i < VA_MAX_SINKS; ++i)
+    {
+        VA_SinkEntry_t *s = &s_va_sinks[i];
+        VA_SinkFn fn = s->fn;
+        if (fn == NULL || (s->class_mask & bit) == 0u)
+            continue;
+        if (s->rate != 0u)
+        {
+            if (s->tokens < length)
+            {
+                s->dropped++;
+                continue;
+            }
+            s->tokens -= length;
+        }
+        fn(s->ctx, data, length);
+    }
+}
+
+int VA_AddSink(const VA_Sink_t *sink)
+{
+    if (sink == NULL || sink->fn == NULL)
+        return -1;
+
+    int handle = -1;
+    VA_CS_ENTER();
+    for (uint32_t i = 0; i < VA_MAX_SINKS; ++i)
+    {
+        VA_SinkEntry_t *s = &s_va_sinks[i];
+        if (s->fn != NULL)
+            continue;
+        s->ctx = sink->ctx;
+        s->class_mask = sink->classMask;
+        s->rate = sink->bytesPerSecond;
+        s->burst = (sink->burstBytes != 0u) ? sink->burstBytes : sink->bytesPerSecond;
+        s->tokens = s->burst;
+        s->refilled = _va_get_timestamp();
+        s->dropped = 0;
+        __DMB();
+        s->fn = sink->fn; /* publish last: the drain may be running */
+        handle = (int)i;
+        break;
+    }
+    VA_CS_EXIT();
+    return handle;
+}
+
+/* Stops the sink for every VA_Drain() that starts after this returns.  A
+ * drain already in progress may still be inside the sink, so ctx may
+ * only be freed once no drain can be running.
+ * Removing a sink from within its own callback is fine. */
+void VA_RemoveSink(int handle)
+{
+    if (handle < 0 || handle >= (int)VA_MAX_SINKS)
+        return;
+    VA_CS_ENTER();
+    s_va_sinks[handle].fn = NULL;
+    __DMB();
+    VA_CS_EXIT();
+}
+
+void VA_SetSinkClasses(int handle, uint32_t classMask)
+{
+    if (handle < 0 || handle >= (int)VA_MAX_SINKS)
+        return;
+    s_va_sinks[handle].class_mask = classMask;
+}
+
+uint32_t VA_GetSinkDropped(int handle)
+{
+    if (handle < 0 || handle >= (int)VA_MAX_SINKS)
+        return 0;
+    return s_va_sinks[handle].dropped;
+}
+
+void VA_RamSinkInit(VA_RamSink_t *ram, void *buf, uint32_t size)
+{
+    ram->buf = (uint8_t *)buf;
+    ram->size = size;
+    ram->head = 0;
+    ram->wrapped = false;
+}
+
+void VA_RamSinkWrite(void *ctx, const uint8_t *packet, uint32_t length)
+{
+    VA_RamSink_t *ram = (VA_RamSink_t *)ctx;
+    uint8_t frame[VA_MAX_PACKET_SIZE + (VA_MAX_PACKET_SIZE / 254) + 2];
+    if (length > VA_MAX_PACKET_SIZE)
+        return;
+    uint32_t n = (uint32_t)va_cobs_encode(packet, (size_t)length, frame);
+    if (n > ram->size)
+        return;
+
+    /* The oldest frame is overwritten from its start; the decoder skips
+     * the torn remainder up to its 0x00 */
+    uint32_t first = ram->size - ram->head;
+    if (first > n)
+        first = n;
+    memcpy(&ram->buf[ram->head], frame, first);
+    memcpy(ram->buf, &frame[first], n - first);
+    ram->head += n;
+    if (ram->head >= ram->size)
+    {
+        ram->head -= ram->size;
+        ram->wrapped = true;
+    }
+}
+
+uint32_t VA_RamSinkRead(const VA_RamSink_t *ram, uint8_t *dst, uint32_t max)
+{
+    uint32_t start = ram->wrapped ? ram->head : 0u;
+    uint32_t len = ram->wrapped ? ram->size : ram->head;
+    if (len > max)
+    {
+        start += len - max; /* keep the newest */
+        len = max;
+    }
+    if (start >= ram->size)
+        start -= ram->size;
+    uint32_t first = ram->size - start;
+    if (first > len)
+        first = len;
+    memcpy(dst, &ram->buf[start], first);
+    memcpy(&dst[first], ram->buf, len - first);
+    return len;
+}
+
+#endif /* VA_SINKS */
+
+/* ================================================================
+ *  Deferred-drain ring buffer
+ *
+ *  Producers (every hook, any priority) reserve a record with a single
+ *  LDREX/STREX on the head index, copy the packet in and commit it by
+ *  writing the record header.  VA_Drain() is the only consumer: it walks
+ *  committed records from the tail and hands them to the transport, so
+ *  ITM_WaitReady / RTT blocking happens in the drain context instead of
+ *  inside the context-switch or ISR path.
+ *
+ *  Record layout (4-byte aligned, never wraps):
+ *    [header u32: length | flags][packet bytes][pad to 4]
+ *  A record that would straddle the end of the buffer is preceded by a
+ *  PAD record that fills the remainder, so payloads are always contiguous.
+ *  A header reads as 0 until committed — the consumer zeroes everything it
+ *  releases, so stale bytes from a previous lap never look committed.
+ * ================================================================ */
+#if VA_USE_RING_BUFFER
+
+#if ((VA_RING_BUFFER_SIZE) & ((VA_RING_BUFFER_SIZE) - 1u)) != 0
+#error "VA_RING_BUFFER_SIZE must be a power of two"
+#endif
+#if (VA_RING_BUFFER_SIZE) < (2u * ((VA_MAX_PACKET_SIZE) + 8u))
+#error "VA_RING_BUFFER_SIZE must hold at least two maximum-size packets"
+#endif
+
+#define VA_RING_MASK          ((uint32_t)(VA_RING_BUFFER_SIZE) - 1u)
+#define VA_RING_COMMITTED     0x80000000u
+#define VA_RING_PAD           0x40000000u
+#define VA_RING_LEN_MASK      0x0000FFFFu
+#define VA_RING_RECORD_SIZE(len) (4u + (((uint32_t)(len) + 3u) & ~3u))
+
+/* Priority shedding: each class may fill the ring only up to its level, so
+ * under backpressure user traces and logs go first, then sync objects, and
+ * the scheduling timeline survives longest. */
+#if VA_PRIORITY_SHEDDING
+#if VA_FLIGHT_RECORDER
+#error "VA_PRIORITY_SHEDDING cannot be combined with VA_FLIGHT_RECORDER (it evicts old packets instead)"
+#endif
+#if (VA_SHED_LEVEL_TASK < 1) || (VA_SHED_LEVEL_TASK > 100) || (VA_SHED_LEVEL_ISR < 1) || (VA_SHED_LEVEL_ISR > 100) || \
+    (VA_SHED_LEVEL_SYNC < 1) || (VA_SHED_LEVEL_SYNC > 100) || (VA_SHED_LEVEL_USER < 1) || (VA_SHED_LEVEL_USER > 100) || \
+    (VA_SHED_LEVEL_LOG < 1) || (VA_SHED_LEVEL_LOG > 100) || (VA_SHED_LEVEL_SYSTEM < 1) || (VA_SHED_LEVEL_SYSTEM > 100)
+#error "VA_SHED_LEVEL_* must be between 1 and 100 (percent of VA_RING_BUFFER_SIZE)"
+#endif
+
+#define VA_SHED_LIMIT(pct) ((uint32_t)(((uint64_t)(VA_RING_BUFFER_SIZE) * (pct)) / 100u))
+
+static const uint32_t s_va_ring_limit[VA_CLASS_COUNT] = {
+    [VA_CLASS_TASK]   = VA_SHED_LIMIT(VA_SHED_LEVEL_TASK),
+    [VA_CLASS_ISR]    = VA_SHED_LIMIT(VA_SHED_LEVEL_ISR),
+    [VA_CLASS_SYNC]   = VA_SHED_LIMIT(VA_SHED_LEVEL_SYNC),
+    [VA_CLASS_USER]   = VA_SHED_LIMIT(VA_SHED_LEVEL_USER),
+    [VA_CLASS_LOG]    = VA_SHED_LIMIT(VA_SHED_LEVEL_LOG),
+    [VA_CLASS_SYSTEM] = VA_SHED_LIMIT(VA_SHED_LEVEL_SYSTEM),
+};
+#define VA_RING_LIMIT(cls) s_va_ring_limit[cls]
+#else
+#define VA_RING_LIMIT(cls) ((uint32_t)(VA_RING_BUFFER_SIZE))
+#endif
+
+typedef struct
+{
+    uint32_t          buf[(VA_RING_BUFFER_SIZE) / 4u];
+    volatile uint32_t head;      /* next byte to reserve (free-running) */
+    volatile uint32_t tail;      /* next byte to drain   (free-running) */
+    volatile uint32_t dropped;
+#if VA_LOSS_REPORTS
+    VA_Loss_t         loss;      /* shed since the last report */
+#endif
+} VA_Ring_t;
+
+/* One ring per core (VA_NUM_CORES), so producers never contend across cores */
+static VA_Ring_t         s_va_rings[VA_NUM_CORES];
+static volatile uint32_t s_va_ring_draining = 0;
+#if VA_NUM_CORES > 1
+static uint32_t          s_va_drain_first = 0;   /* ring the next drain starts with */
+#endif
+
+static inline VA_Ring_t *_va_ring_local(void)
+{
+    return &s_va_rings[VA_CORE_ID()];
+}
+
+static inline volatile uint32_t *_va_ring_word(VA_Ring_t *ring, uint32_t pos)
+{
+    return (volatile uint32_t *)&ring->buf[(pos & VA_RING_MASK) >> 2];
+}
+
+/* Claim a record for `length` bytes if the ring stays within `limit` bytes */
+static uint8_t *_va_ring_claim(VA_Ring_t *ring, uint32_t length, uint32_t limit)
+{
+    uint32_t need = VA_RING_RECORD_SIZE(length);
+    uint32_t head, pad, offset;
+
+    do
+    {
+        head = __LDREXW(&ring->head);
+        offset = head & VA_RING_MASK;
+        pad = (offset + need > (VA_RING_BUFFER_SIZE)) ? ((VA_RING_BUFFER_SIZE) - offset) : 0u;
+        if ((head - ring->tail) + pad + need > limit)
+        {
+            __CLREX();
+            return NULL;
+        }
+    } while (__STREXW(head + pad + need, &ring->head) != 0u);
+
+    if (pad != 0u)
+    {
+        /* Skip the tail end of the buffer; the drain discards this record */
+        *_va_ring_word(ring, head) = VA_RING_COMMITTED | VA_RING_PAD | (pad - 4u);
+        head += pad;
+    }
+    return (uint8_t *)&ring->buf[((head & VA_RING_MASK) >> 2) + 1u];
+}
+
+void _va_ring_commit(uint8_t *payload, uint32_t length)
+{
+    __DMB(); /* payload must be visible before the header publishes it */
+    ((volatile uint32_t *)(void *)payload)[-1] = VA_RING_COMMITTED | length;
+}
+
+static void _va_ring_drop(VA_Ring_t *ring, uint8_t type_byte, uint32_t length)
+{
+    ring->dropped++;
+#if VA_LOSS_REPORTS
+    _va_loss_count(&ring->loss, type_byte, length);
+#else
+    VA_UNUSED(type_byte);
+    VA_UNUSED(length);
+#endif
+}
+
+#if VA_LOSS_REPORTS
+/* The report is queued ahead of the next packet, and only if that packet
+ * will fit behind it — otherwise a flood of shed packets would fill the
+ * ring with reports. */
+static bool _va_ring_report_loss(VA_Ring_t *ring, uint32_t limit, uint32_t length)
+{
+    uint8_t packet[VA_LOSS_PACKET_SIZE];
+    uint32_t need = VA_RING_RECORD_SIZE(length);
+    if (limit <= need)
+        return false;
+    uint32_t n = _va_loss_build(&ring->loss, packet);
+    uint8_t *slot = _va_ring_claim(ring, n, limit - need);
+    if (slot == NULL)
+        return false;
+    memcpy(slot, packet, n);
+    _va_ring_commit(slot, n);
+    _va_loss_reported(&ring->loss);
+    return true;
+}
+#endif
+
+uint8_t *_va_ring_reserve(uint32_t length, uint8_t type_byte)
+{
+    VA_Ring_t *ring = _va_ring_local();
+    uint32_t limit = VA_RING_LIMIT(_va_packet_class(type_byte));
+    uint8_t *slot = NULL;
+
+#if VA_LOSS_REPORTS
+    if (ring->loss.events == 0 || _va_ring_report_loss(ring, limit, length))
+#endif
+    {
+        slot = _va_ring_claim(ring, length, limit);
+    }
+    if (slot == NULL)
+    {
+        _va_ring_drop(ring, type_byte, length);
+    }
+    return slot;
+}
+
+static bool _va_ring_push(const uint8_t *data, uint32_t length)
+{
+    if (!VA_IS_INIT)
+        return true;
+    if (length > VA_RING_LEN_MASK)
+        return false;
+    uint8_t *slot = _va_ring_reserve(length, data[0]);
+    if (slot == NULL)
+        return false;
+    memcpy(slot, data, length);
+    _va_ring_commit(slot, length);
+    return true;
+}
+
+static void _va_ring_reset(void)
+{
+    memset(s_va_rings, 0, sizeof(s_va_rings));
+    s_va_ring_draining = 0;
+#if VA_NUM_CORES > 1
+    s_va_drain_first = 0;
+#endif
+}
+
+#if VA_FLIGHT_RECORDER
+/* ================================================================
+ *  Flight recorder
+ *
+ *  ARMED      packets are kept in the ring, the oldest evicted once it
+ *             holds VA_FLIGHT_PRE_TRIGGER_BYTES; VA_Drain() sends nothing.
+ *  TRIGGERED  a trigger fired; the next VA_FLIGHT_POST_TRIGGER_BYTES are
+ *             recorded without eviction.
+ *  FROZEN     the window is complete; new packets are discarded until
+ *             VA_Drain() has shipped it, then the recorder re-arms.
+ *
+ *  Eviction moves the tail from the producer side, so every state change
+ *  and every armed push happens inside a critical section.
+ * ================================================================ */
+#if !VA_ALLOWED_TO_DISABLE_INTERRUPTS
+#error "VA_FLIGHT_RECORDER needs VA_ALLOWED_TO_DISABLE_INTERRUPTS"
+#endif
+#if VA_COMPACT_TIMESTAMPS
+#error "VA_FLIGHT_RECORDER cannot be combined with VA_COMPACT_TIMESTAMPS (evicted deltas break the chain)"
+#endif
+#if (VA_FLIGHT_PRE_TRIGGER_BYTES) < ((VA_MAX_PACKET_SIZE) + 8u) || \
+    (VA_FLIGHT_PRE_TRIGGER_BYTES) + ((VA_MAX_PACKET_SIZE) + 8u) > (VA_RING_BUFFER_SIZE)
+#error "VA_FLIGHT_PRE_TRIGGER_BYTES must hold one maximum-size packet and leave room for another in the ring"
+#endif
+
+#define VA_FR_ARMED     0u
+#define VA_FR_TRIGGERED 1u
+#define VA_FR_FROZEN    2u
+
+static volatile uint8_t  s_va_fr_state = VA_FR_ARMED;
+static uint32_t          s_va_fr_post_left = 0;
+static bool              s_va_fr_dumping = false;  /* drain has started shipping the window   */
+static bool              s_va_fr_direct = false;   /* bypass the ring (bundle leading a dump)   */
+
+static uint8_t  s_va_fr_event_type = 0;
+static uint8_t  s_va_fr_event_id = 0;
+static uint8_t  s_va_fr_span_type = 0;
+static uint8_t  s_va_fr_span_id = 0;
+static uint32_t s_va_fr_span_max = 0;
+static uint64_t s_va_fr_span_start = 0;
+static bool     s_va_fr_span_open = false;
+static bool     s_va_fr_on_contention = false;
+
+static void _va_fr_reset(void)
+{
+    s_va_fr_state = VA_FR_ARMED;
+    s_va_fr_post_left = 0;
+    s_va_fr_dumping = false;
+    s_va_fr_direct = false;
+    s_va_fr_span_open = false;
+}
+
+static void _va_fr_fire(void)
+{
+    if (s_va_fr_state != VA_FR_ARMED)
+        return;
+    s_va_fr_post_left = VA_FLIGHT_POST_TRIGGER_BYTES;
+    s_va_fr_state = (s_va_fr_post_left > 0u) ? VA_FR_TRIGGERED : VA_FR_FROZEN;
+}
+
+/* Drop the oldest records until `length` more bytes fit in the pre-trigger
+ * window.  Fails if the oldest record is still being written. */
+static bool _va_fr_evict(uint32_t length)
+{
+    VA_Ring_t *ring = _va_ring_local();
+    uint32_t need = VA_RING_RECORD_SIZE(length);
+    uint32_t tail = ring->tail;
+    while ((ring->head - tail) + need > (VA_FLIGHT_PRE_TRIGGER_BYTES))
+    {
+        uint32_t header = *_va_ring_word(ring, tail);
+        if ((header & VA_RING_COMMITTED) == 0u)
+            return false;
+        uint32_t record = VA_RING_RECORD_SIZE(header & VA_RING_LEN_MASK);
+        memset(&ring->buf[(tail & VA_RING_MASK) >> 2], 0, record);
+        tail += record;
+        ring->tail = tail;
+    }
+    return true;
+}
+
+/* Match a freshly recorded packet against the configured triggers.  Event
+ * packets are [type][id][timestamp 8B]...; contention carries no span. */
+static void _va_fr_inspect(const uint8_t *data, uint32_t length)
+{
+    uint8_t type = data[0] & VA_EVENT_TYPE_MASK;
+
+    if (s_va_fr_on_contention && data[0] == VA_EVENT_MUTEX_CONTENTION)
+    {
+        _va_fr_fire();
+    }
+    else if (s_va_fr_event_type != 0 && type == s_va_fr_event_type && data[1] == s_va_fr_event_id)
+    {
+        _va_fr_fire();
+    }
+    else if (s_va_fr_span_max != 0 && type == s_va_fr_span_type && data[1] == s_va_fr_span_id && length >= 10)
+    {
+        uint64_t ts = 0;
+        for (int i = 7; i >= 0; --i)
+            ts = (ts << 8) | data[2 + i];
+
+        if (data[0] & VA_EVENT_FLAG_START_END)
+        {
+            s_va_fr_span_start = ts;
+            s_va_fr_span_open = true;
+        }
+        else if (s_va_fr_span_open)
+        {
+            s_va_fr_span_open = false;
+            if (ts - s_va_fr_span_start > s_va_fr_span_max)
+                _va_fr_fire();
+        }
+    }
+}
+
+static bool _va_fr_push(const uint8_t *data, uint32_t length)
+{
+    bool ok = true;
+    VA_CS_ENTER();
+    switch (s_va_fr_state)
+    {
+    case VA_FR_ARMED:
+        if (!_va_fr_evict(length))
+        {
+            _va_ring_local()->dropped++;
+            ok = false;
+        }
+        else if ((ok = _va_ring_push(data, length)))
+        {
+            _va_fr_inspect(data, length);
+        }
+        break;
+    case VA_FR_TRIGGERED:
+    {
+        uint32_t record = VA_RING_RECORD_SIZE(length);
+        ok = _va_ring_push(data, length);
+        if (!ok || record >= s_va_fr_post_left)
+        {
+            s_va_fr_post_left = 0;
+            s_va_fr_state = VA_FR_FROZEN;
+        }
+        else
+        {
+            s_va_fr_post_left -= record;
+        }
+        break;
+    }
+    default:
+        break; /* outside the capture window: discarded, not lost */
+    }
+    VA_CS_EXIT();
+    return ok;
+}
+
+void VA_Trigger(void)
+{
+    VA_CS_ENTER();
+    _va_fr_fire();
+    VA_CS_EXIT();
+}
+
+void VA_SetTriggerEvent(uint8_t type, uint8_t id)
+{
+    VA_CS_ENTER();
+    s_va_fr_event_type = type & VA_EVENT_TYPE_MASK;
+    s_va_fr_event_id = id;
+    VA_CS_EXIT();
+}
+
+void VA_SetTriggerSpan(uint8_t type, uint8_t id, uint32_t maxCycles)
+{
+    VA_CS_ENTER();
+    s_va_fr_span_type = type & VA_EVENT_TYPE_MASK;
+    s_va_fr_span_id = id;
+    s_va_fr_span_max = maxCycles;
+    s_va_fr_span_open = false;
+    VA_CS_EXIT();
+}
+
+void VA_SetTriggerOnContention(bool enable)
+{
+    s_va_fr_on_contention = enable;
+}
+
+#endif /* VA_FLIGHT_RECORDER */
+
+/* Send committed records from one ring until it is empty, a record is
+ * still being written or the byte budget is spent.  Returns the updated
+ * byte count. */
+static uint32_t _va_drain_ring(VA_Ring_t *ring, uint32_t maxBytes, uint32_t sent)
+{
+    uint32_t tail = ring->tail;
+    while (tail != ring->head)
+    {
+        uint32_t header = *_va_ring_word(ring, tail);
+        if ((header & VA_RING_COMMITTED) == 0u)
+            break; /* oldest record is still being written by a producer */
+
+        uint32_t length = header & VA_RING_LEN_MASK;
+        if (maxBytes != 0u && sent != 0u && sent + length > maxBytes)
+            break;
+
+#if VA_TRANSPORT_IS_UART_DMA || VA_TRANSPORT_IS_LWIP_UDP
+        if ((header & VA_RING_PAD) == 0u && !_va_transport_fits(length))
+            break; /* no room downstream: leave it in the ring */
+#endif
+
+        uint32_t offset = tail & VA_RING_MASK;
+        uint32_t record = VA_RING_RECORD_SIZE(length);
+        if ((header & VA_RING_PAD) == 0u)
+        {
+            const uint8_t *packet = (const uint8_t *)&ring->buf[(offset >> 2) + 1u];
+            _va_emit_packet_raw(packet, length);
+#if VA_SINKS
+            _va_sinks_packet(packet, length);
+#endif
+            sent += length;
+        }
+
+        memset(&ring->buf[offset >> 2], 0, record);
+        __DMB();
+        tail += record;
+        ring->tail = tail;
+    }
+    return sent;
+}
+
+uint32_t VA_Drain(uint32_t maxBytes)
+{
+    /* Single consumer: a drain that preempts another drain backs off */
+    do
+    {
+        if (__LDREXW(&s_va_ring_draining) != 0u)
+        {
+            __CLREX();
+            return 0;
+        }
+    } while (__STREXW(1u, &s_va_ring_draining) != 0u);
+    __DMB();
+
+#if VA_FLIGHT_RECORDER
+    if (s_va_fr_state == VA_FR_ARMED)
+    {
+        s_va_ring_draining = 0;
+        return 0; /* nothing leaves the target until a trigger fires */
+    }
+    if (!s_va_fr_dumping)
+    {
+        /* Lead the window with sync + maps so the host can decode it; the
+         * early setup packets were evicted long ago. */
+        VA_CS_ENTER();
+        s_va_fr_dumping = true;
+        s_va_fr_direct = true;
+        VA_EmitSetupBundle();
+        s_va_fr_direct = false;
+        VA_CS_EXIT();
+    }
+#endif
+
+#if VA_SINKS
+    _va_sinks_refill();
+#endif
+
+#if VA_SETUP_BUNDLE_CHUNK > 0
+    if (_va_bundle_active)
+    {
+        VA_CS_ENTER();
+        VA_SMP_LOCK();
+        if (_va_bundle_active)
+            (void)_va_bundle_step(VA_SETUP_BUNDLE_CHUNK);
+        VA_SMP_UNLOCK();
+        VA_CS_EXIT();
+    }
+#endif
+
+#if VA_NUM_CORES > 1
+    /* Rotate the starting ring so a busy core can't starve the others of
+     * a limited budget.  The host orders packets by timestamp. */
+    uint32_t sent = 0;
+    uint32_t first = s_va_drain_first;
+    s_va_drain_first = (first + 1u) % VA_NUM_CORES;
+    for (uint32_t i = 0; i < VA_NUM_CORES; ++i)
+    {
+        sent = _va_drain_ring(&s_va_rings[(first + i) % VA_NUM_CORES], maxBytes, sent);
+    }
+#else
+    uint32_t sent = _va_drain_ring(&s_va_rings[0], maxBytes, 0);
+#endif
+
+#if VA_FLIGHT_RECORDER
+    if (s_va_fr_state == VA_FR_FROZEN && s_va_rings[0].tail == s_va_rings[0].head)
+    {
+        _va_fr_reset(); /* window shipped: re-arm */
+    }
+#endif
+
+#if VA_COMPRESS
+    _va_lz_flush();
+#endif
+#if VA_TRANSPORT_IS_UART_DMA || VA_TRANSPORT_IS_LWIP_UDP
+    _va_transport_flush();
+#endif
+
+    __DMB();
+    s_va_ring_draining = 0;
+    return sent;
+}
+
+uint32_t VA_GetDroppedCount(void)
+{
+    uint32_t dropped = 0;
+    for (uint32_t i = 0; i < VA_NUM_CORES; ++i)
+    {
+        dropped += s_va_rings[i].dropped;
+    }
+#if VA_TRANSPORT_IS_UART_DMA
+    dropped += s_va_uart.dropped;
+#elif VA_TRANSPORT_IS_LWIP_UDP
+    dropped += s_va_lwip.dropped;
+#endif
+    return dropped;
+}
+
+#if VA_LOSS_REPORTS
+uint32_t VA_GetLostEvents(VA_TraceClass_t cls)
+{
+    uint32_t lost = 0;
+    for (uint32_t i = 0; ((uint32_t)cls < VA_CLASS_COUNT) && (i < VA_NUM_CORES); ++i)
+    {
+        lost += s_va_rings[i].loss.total_events[cls];
+    }
+    return lost;
+}
+
+uint32_t VA_GetLostBytes(VA_TraceClass_t cls)
+{
+    uint32_t lost = 0;
+    for (uint32_t i = 0; ((uint32_t)cls < VA_CLASS_COUNT) && (i < VA_NUM_CORES); ++i)
+    {
+        lost += s_va_rings[i].loss.total_bytes[cls];
+    }
+    return lost;
+}
+#endif
+
+#else
+
+#if VA_FLIGHT_RECORDER
+#error "VA_FLIGHT_RECORDER requires VA_USE_RING_BUFFER"
+#endif
+
+uint32_t VA_Drain(uint32_t maxBytes)
+{
+    VA_UNUSED(maxBytes);
+    return 0;
+}
+
+uint32_t VA_GetDroppedCount(void)
+{
+#if VA_TRANSPORT_IS_ITM && VA_ITM_NONBLOCKING
+    uint32_t dropped = 0;
+    for (uint32_t c = 0; c < VA_CLASS_COUNT; ++c)
+    {
+        dropped += s_va_itm_loss.total_events[c];
+    }
+    return dropped;
+#elif VA_TRANSPORT_IS_UART_DMA
+    return s_va_uart.dropped;
+#else
+    return 0;
+#endif
+}
+
+#if VA_TRANSPORT_IS_ITM && VA_ITM_NONBLOCKING
+uint32_t VA_GetLostEvents(VA_TraceClass_t cls)
+{
+    return ((uint32_t)cls < VA_CLASS_COUNT) ? s_va_itm_loss.total_events[cls] : 0u;
+}
+
+uint32_t VA_GetLostBytes(VA_TraceClass_t cls)
+{
+    return ((uint32_t)cls < VA_CLASS_COUNT) ? s_va_itm_loss.total_bytes[cls] : 0u;
+}
+#endif
+
+#endif /* VA_USE_RING_BUFFER */
+
+#if !VA_LOSS_REPORTS
+uint32_t VA_GetLostEvents(VA_TraceClass_t cls)
+{
+    VA_UNUSED(cls);
+    return 0;
+}
+
+uint32_t VA_GetLostBytes(VA_TraceClass_t cls)
+{
+    VA_UNUSED(cls);
+    return 0;
+}
+#endif
+
+/* Hand one packet to the ring or the transport, without the auto-bundle
+ * check.  Returns false if the packet was dropped. */
+static bool _va_push_packet(const uint8_t *data, uint32_t length)
+{
+#if VA_FLIGHT_RECORDER
+    if (s_va_fr_direct)
+    {
+        _va_emit_packet_raw(data, length);
+        return true;
+    }
+    return _va_fr_push(data, length);
+#elif VA_USE_RING_BUFFER
+#if VA_COMPACT_TIMESTAMPS
+    /* After a drop the host's delta chain is broken until the next anchor
+     * lands — anything queued before it would decode at the wrong time. */
+    if (_va_ts_resync && data[0] != VA_SETUP_TIME_ANCHOR)
+    {
+        _va_ring_drop(_va_ring_local(), data[0], length);
+        return false;
+    }
+    if (!_va_ring_push(data, length))
+    {
+        _va_ts_resync = true;
+        return false;
+    }
+    return true;
+#else
+    return _va_ring_push(data, length);
+#endif
+#elif VA_COMPACT_TIMESTAMPS && VA_TRANSPORT_IS_ITM && VA_ITM_NONBLOCKING
+    /* Same guard as the ring: nothing goes out against a lost anchor */
+    if (_va_ts_resync && data[0] != VA_SETUP_TIME_ANCHOR)
+    {
+        _va_itm_count_loss(data, length);
+        return false;
+    }
+    _va_emit_packet_raw(data, length);
+    return !_va_ts_resync;   /* set again if the port dropped it */
+#else
+    _va_emit_packet_raw(data, length);
+    return true;
+#endif
+}
+
+void _va_emit_packet(const uint8_t *data, uint32_t length)
+{
+    /* The triggering packet goes out FIRST, the periodic bundle after it.
+     * The packet's position on the wire is what time-correlation (fused
+     * ETM+ITM captures) anchors on — emitting the bundle first would place
+     * an event's bytes hundreds of ms after the code that logged it, so a
+     * "jump to cause" lands in the bundle loop instead of the caller. The
+     * host's sync scanning is order-agnostic, so parsing is unaffected. */
+    (void)_va_push_packet(data, length);
+    _va_after_emit();
+}
+
+void _va_after_emit(void)
+{
+    if (_va_emitting_bundle)
+        return;
+
+#if VA_AUTO_SETUP_INTERVAL_MS > 0
+    /* A flight recorder dump carries its own bundle (see VA_Drain).  On
+     * multi-core builds core 0's clock paces it. */
+    if (!VA_FLIGHT_RECORDER && _va_cpu_freq > 0 && VA_CORE_ID() == 0u)
+    {
+        uint64_t now = _va_get_timestamp();
+        uint64_t interval_cycles = ((uint64_t)_va_cpu_freq / 1000) * VA_AUTO_SETUP_INTERVAL_MS;
+        if (now - _va_last_bundle_ts >= interval_cycles)
+        {
+            _va_last_bundle_ts = now;
+#if VA_SETUP_BUNDLE_CHUNK > 0
+            VA_CS_ENTER();
+            VA_SMP_LOCK();
+            if (!_va_bundle_active)
+            {
+                _va_bundle_cursor = 0;
+                _va_bundle_active = true;
+            }
+            VA_SMP_UNLOCK();
+            VA_CS_EXIT();
+#else
+            VA_EmitSetupBundle();
+#endif
+        }
+    }
+#endif
+
+#if (VA_SETUP_BUNDLE_CHUNK > 0) && !VA_USE_RING_BUFFER
+    /* Without a ring the bundle rides along with live events; with one,
+     * VA_Drain() advances it outside the hooks. */
+    if (_va_bundle_active)
+    {
+        VA_CS_ENTER();
+        (void)_va_bundle_step(VA_SETUP_BUNDLE_CHUNK);
+        VA_CS_EXIT();
+    }
+#endif
+}
+
+/* ================================================================
+ *  Field encoders
+ * ================================================================ */
+
+/* Packets are little-endian byte streams with no alignment.  Where the
+ * core handles unaligned word accesses (Cortex-M3/M4/M7/M33, and x86 for
+ * the host builds) a field is one store; memcpy keeps that well-defined
+ * C.  Cortex-M0/M23 and big-endian builds store byte by byte. */
+#if (defined(__ARM_FEATURE_UNALIGNED) || defined(__x86_64__) || defined(__i386__)) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define VA_UNALIGNED_STORES 1
+#else
+#define VA_UNALIGNED_STORES 0
+#endif
+
+static inline uint32_t _va_put_u32(uint8_t *p, uint32_t value)
+{
+#if VA_UNALIGNED_STORES
+    memcpy(p, &value, 4);
+#else
+    p[0] = (uint8_t)(value >> 0);
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+#endif
+    return 4;
+}
+
+static inline uint32_t _va_put_u64(uint8_t *p, uint64_t value)
+{
+    _va_put_u32(&p[0], (uint32_t)value);
+    _va_put_u32(&p[4], (uint32_t)(value >> 32));
+    return 8;
+}
+
+#if VA_COMPACT_TIMESTAMPS
+/* Absolute time for the host, and the new base for the following deltas.
+ * Pushed directly (no auto-bundle check) because it is sent from inside
+ * packet construction. */
+static void _va_send_time_anchor(uint64_t timestamp)
+{
+    uint8_t packet[10];
+    packet[0] = VA_SETUP_TIME_ANCHOR;
+    packet[1] = 0;
+    _va_put_u64(&packet[2], timestamp);
+    _va_last_ts = timestamp;
+    _va_ts_resync = false;
+    (void)_va_push_packet(packet, 10);   /* re-arms _va_ts_resync if dropped */
+}
+
+/* Unsigned LEB128 delta from the previous event: 7 bits per byte, high bit
+ * set on every byte except the last.  Must run in the same critical
+ * section that emits the packet so deltas reach the wire in order. */
+static uint32_t _va_put_timestamp(uint8_t *p, uint64_t timestamp)
+{
+    if (_va_ts_resync || timestamp < _va_last_ts)
+    {
+        _va_send_time_anchor(timestamp < _va_last_ts ? timestamp : _va_last_ts);
+        if (_va_ts_resync)
+        {
+            /* The anchor was dropped, so this packet has no base either:
+             * _va_push_packet() drops and counts it.  Keep the old base
+             * and give the doomed packet a one-byte placeholder. */
+            p[0] = 0;
+            return 1;
+        }
+    }
+
+    uint64_t delta = timestamp - _va_last_ts;
+    _va_last_ts = timestamp;
+
+    uint32_t n = 0;
+    while (delta >= 0x80u)
+    {
+        p[n++] = (uint8_t)(delta | 0x80u);
+        delta >>= 7;
+    }
+    p[n++] = (uint8_t)delta;
+    return n;
+}
+#else
+static inline uint32_t _va_put_timestamp(uint8_t *p, uint64_t timestamp)
+{
+    return _va_put_u64(p, timestamp);
+}
+#endif
+
+/* ================================================================
+ *  Packet serializer
+ *
+ *  Every timestamped packet has the shape
+ *    [type][id][pre u8 ...][timestamp][u32 ...][post u8 ...]
+ *  and is described by one row of s_va_layouts.  _va_send_packet() writes
+ *  all of them except the two hottest, [type][id][ts] (ISR, task switch,
+ *  user event) and [type][id][ts][u32] (trace values, counters, queue and
+ *  heap events), which _va_send_short_packet() writes without the layout
+ *  loops.  The per-type senders below are a single call each.
+ * ================================================================ */
+typedef enum
+{
+    VA_LAYOUT_CORE_EVENT = 0, /* [type][id][ts][core]                */
+    VA_LAYOUT_TOGGLE,        /* [type][id][ts][state]                */
+    VA_LAYOUT_NOTIFICATION,  /* [type][id][other][ts][u32]           */
+    VA_LAYOUT_CONTENTION,    /* [type][mutex][waiter][holder][ts]    */
+    VA_LAYOUT_STACK_USAGE,   /* [type][id][ts][used][total]          */
+    VA_LAYOUT_TASK_CREATE    /* [type][id][ts][prio][base][stack]    */
+} VA_PacketLayoutId_t;
+
+typedef struct
+{
+    uint8_t pre   : 2;  /* u8 fields between the id and the timestamp */
+    uint8_t words : 2;  /* u32 fields after the timestamp */
+    uint8_t post  : 1;  /* u8 fields after the u32 fields */
+} VA_PacketLayout_t;
+
+static const VA_PacketLayout_t s_va_layouts[] = {
+    [VA_LAYOUT_CORE_EVENT]   = {0, 0, 1},
+    [VA_LAYOUT_TOGGLE]       = {0, 0, 1},
+    [VA_LAYOUT_NOTIFICATION] = {1, 1, 0},
+    [VA_LAYOUT_CONTENTION]   = {2, 0, 0},
+    [VA_LAYOUT_STACK_USAGE]  = {0, 2, 0},
+    [VA_LAYOUT_TASK_CREATE]  = {0, 3, 0},
+};
+
+/* Largest packet the field widths above can describe */
+#define VA_LAYOUT_MAX_BYTES (2u + 3u + VA_TS_MAX_BYTES + 12u + 1u)
+
+/* Zero-copy RTT in direct mode: the packet is built in the up-buffer itself
+ * when it fits before the wrap.  Not with compact timestamps, whose anchor
+ * packet may be written while the reservation is open. */
+#define VA_RTT_IN_PLACE (VA_TRANSPORT_IS_JLINK && VA_RTT_ZERO_COPY && !VA_USE_RING_BUFFER && \
+                         VA_ALLOWED_TO_DISABLE_INTERRUPTS && !VA_COMPACT_TIMESTAMPS)
+
+/* Hand a finished packet on.  `local` is the stack buffer it was built in
+ * unless the in-place RTT reservation succeeded. */
+static inline void _va_finish_packet(uint8_t *packet, const uint8_t *local, uint32_t n)
+{
+#if VA_RTT_IN_PLACE
+    if (packet != local)
+    {
+        _va_rtt_commit(packet, n);
+        _va_after_emit();
+        return;
+    }
+#else
+    VA_UNUSED(local);
+#endif
+    _va_emit_packet(packet, n);
+}
+
+/* `bytes` holds the pre fields followed by the post fields */
+static void _va_send_packet(VA_PacketLayoutId_t layout, uint8_t type_byte, uint8_t id,
+                            const uint8_t *bytes, const uint32_t *words, uint64_t timestamp)
+{
+    const VA_PacketLayout_t l = s_va_layouts[layout];
+    uint32_t n = 0;
+    uint32_t i;
+
+    if (!_va_ctl_allows(_va_packet_class(type_byte), id))
+        return;
+
+#if VA_RTT_IN_PLACE
+    uint8_t local[VA_LAYOUT_MAX_BYTES];
+    uint8_t *packet = _va_rtt_reserve(VA_LAYOUT_MAX_BYTES);
+    if (packet == NULL)
+        packet = local;
+#else
+    uint8_t packet[VA_LAYOUT_MAX_BYTES];
+#endif
+
+    packet[n++] = type_byte;
+    packet[n++] = id;
+    for (i = 0; i < l.pre; i++)
+        packet[n++] = *bytes++;
+    n += _va_put_timestamp(&packet[n], timestamp);
+    for (i = 0; i < l.words; i++)
+        n += _va_put_u32(&packet[n], words[i]);
+    if (l.post)
+        packet[n++] = *bytes;
+#if VA_RTT_IN_PLACE
+    _va_finish_packet(packet, local, n);
+#else
+    _va_finish_packet(packet, packet, n);
+#endif
+}
+
+/* [type][id][ts], plus [u32] if has_value: 10 and 14 bytes with full
+ * timestamps.  Inlined into its two callers with has_value constant. */
+static inline void _va_send_short_packet(uint8_t type_byte, uint8_t id, uint64_t timestamp,
+                                         bool has_value, uint32_t value)
+{
+    if (!_va_ctl_allows(_va_packet_class(type_byte), id))
+        return;
+
+#if VA_RTT_IN_PLACE
+    uint8_t local[2 + VA_TS_MAX_BYTES + 4];
+    uint8_t *packet = _va_rtt_reserve(sizeof(local));
+    if (packet == NULL)
+        packet = local;
+#else
+    uint8_t packet[2 + VA_TS_MAX_BYTES + 4];
+#endif
+
+    packet[0] = type_byte;
+    packet[1] = id;
+    uint32_t n = 2 + _va_put_timestamp(&packet[2], timestamp);
+    if (has_value)
+        n += _va_put_u32(&packet[n], value);
+#if VA_RTT_IN_PLACE
+    _va_finish_packet(packet, local, n);
 #else
-    _va_send_bytes(data, length);
+    _va_finish_packet(packet, packet, n);
 #endif
 }
 
-void _va_emit_packet(const uint8_t *data, uint32_t length)
+/* [head ...][name_len][name] with the name cut to VA_MAX_TASK_NAME_LEN - 1 */
+static void _va_send_named_packet(const uint8_t *head, uint32_t head_len, const char *name)
 {
-    /* The triggering packet goes out FIRST, the periodic bundle after it.
-     * The packet's position on the wire is what time-correlation (fused
-     * ETM+ITM captures) anchors on — emitting the bundle first would place
-     * an event's bytes hundreds of ms after the code that logged it, so a
-     * "jump to cause" lands in the bundle loop instead of the caller. The
-     * host's sync scanning is order-agnostic, so parsing is unaffected. */
-    _va_emit_packet_raw(data, length);
-
-#if VA_AUTO_SETUP_INTERVAL_MS > 0
-    if (!_va_emitting_bundle && _va_cpu_freq > 0)
+    uint32_t name_len = (uint32_t)strlen(name);
+    if (name_len >= VA_MAX_TASK_NAME_LEN)
     {
-        uint64_t now = _va_get_timestamp();
-        uint64_t interval_cycles = ((uint64_t)_va_cpu_freq / 1000) * VA_AUTO_SETUP_INTERVAL_MS;
-        if (now - _va_last_bundle_ts >= interval_cycles)
-        {
-            _va_last_bundle_ts = now;
-            _va_emitting_bundle = true;
-            VA_EmitSetupBundle();
-            _va_emitting_bundle = false;
-        }
+        name_len = VA_MAX_TASK_NAME_LEN - 1;
     }
-#endif
+    uint8_t buf[7 + VA_MAX_TASK_NAME_LEN];
+    memcpy(buf, head, head_len);
+    buf[head_len] = (uint8_t)name_len;
+    memcpy(&buf[head_len + 1], name, name_len);
+    _va_emit_packet(buf, head_len + 1 + name_len);
 }
 
 /* ================================================================
@@ -283,262 +2336,161 @@ void _va_emit_packet(const uint8_t *data, uint32_t length)
 
 void _va_send_event_packet(uint8_t type_byte, uint8_t id, uint64_t timestamp)
 {
-    uint8_t packet[10];
-    packet[0] = type_byte;
-    packet[1] = id;
-    packet[2] = (uint8_t)(timestamp >> 0);
-    packet[3] = (uint8_t)(timestamp >> 8);
-    packet[4] = (uint8_t)(timestamp >> 16);
-    packet[5] = (uint8_t)(timestamp >> 24);
-    packet[6] = (uint8_t)(timestamp >> 32);
-    packet[7] = (uint8_t)(timestamp >> 40);
-    packet[8] = (uint8_t)(timestamp >> 48);
-    packet[9] = (uint8_t)(timestamp >> 56);
-    _va_emit_packet(packet, 10);
+    _va_send_short_packet(type_byte, id, timestamp, false, 0);
+}
+
+/* Task-switch and ISR events.  Multi-core builds append the core that ran
+ * them: [type][id][timestamp][core]. */
+static inline void _va_send_core_event_packet(uint8_t type_byte, uint8_t id, uint64_t timestamp)
+{
+#if VA_INLINE_FAST_PATH
+    if (_va_ctl_allows(_va_packet_class(type_byte), id))
+        _va_fast_core_event(type_byte, id, timestamp);
+#elif VA_NUM_CORES > 1
+    uint8_t core = (uint8_t)VA_CORE_ID();
+    _va_send_packet(VA_LAYOUT_CORE_EVENT, type_byte, id, &core, NULL, timestamp);
+#else
+    _va_send_event_packet(type_byte, id, timestamp);
+#endif
 }
 
 void _va_send_setup_packet(uint8_t setupCode, uint8_t id, const char *name)
 {
-    uint8_t name_len = (uint8_t)strlen(name);
-    if (name_len >= VA_MAX_TASK_NAME_LEN)
-    {
-        name_len = VA_MAX_TASK_NAME_LEN - 1;
-    }
-    uint8_t buf[3 + VA_MAX_TASK_NAME_LEN];
-    buf[0] = setupCode;
-    buf[1] = id;
-    buf[2] = name_len;
-    memcpy(&buf[3], name, name_len);
-    _va_emit_packet(buf, 3 + name_len);
+    const uint8_t head[2] = {setupCode, id};
+    _va_send_named_packet(head, sizeof(head), name);
 }
 
 void _va_send_user_setup_packet(uint8_t id, uint8_t type, const char *name)
 {
-    uint8_t name_len = (uint8_t)strlen(name);
-    if (name_len >= VA_MAX_TASK_NAME_LEN)
-    {
-        name_len = VA_MAX_TASK_NAME_LEN - 1;
-    }
-    uint8_t buf[4 + VA_MAX_TASK_NAME_LEN];
-    buf[0] = VA_SETUP_USER_TRACE;
-    buf[1] = id;
-    buf[2] = type;
-    buf[3] = name_len;
-    memcpy(&buf[4], name, name_len);
-    _va_emit_packet(buf, 4 + name_len);
+    const uint8_t head[3] = {VA_SETUP_USER_TRACE, id, type};
+    _va_send_named_packet(head, sizeof(head), name);
 }
 
 void _va_send_user_event_packet(uint8_t id, int32_t value, uint64_t timestamp)
 {
-    uint8_t packet[14];
-    packet[0] = VA_EVENT_USER_TRACE;
-    packet[1] = id;
-    packet[2] = (uint8_t)(timestamp >> 0);
-    packet[3] = (uint8_t)(timestamp >> 8);
-    packet[4] = (uint8_t)(timestamp >> 16);
-    packet[5] = (uint8_t)(timestamp >> 24);
-    packet[6] = (uint8_t)(timestamp >> 32);
-    packet[7] = (uint8_t)(timestamp >> 40);
-    packet[8] = (uint8_t)(timestamp >> 48);
-    packet[9] = (uint8_t)(timestamp >> 56);
-    packet[10] = (uint8_t)(value >> 0);
-    packet[11] = (uint8_t)(value >> 8);
-    packet[12] = (uint8_t)(value >> 16);
-    packet[13] = (uint8_t)(value >> 24);
-    _va_emit_packet(packet, 14);
+    _va_send_data_event_packet(VA_EVENT_USER_TRACE, id, (uint32_t)value, timestamp);
 }
 
 void _va_send_float_event_packet(uint8_t id, float value, uint64_t timestamp)
 {
-    uint8_t packet[14];
     uint32_t fbits;
     memcpy(&fbits, &value, sizeof(fbits));
-    packet[0] = VA_EVENT_FLOAT_TRACE;
-    packet[1] = id;
-    packet[2] = (uint8_t)(timestamp >> 0);
-    packet[3] = (uint8_t)(timestamp >> 8);
-    packet[4] = (uint8_t)(timestamp >> 16);
-    packet[5] = (uint8_t)(timestamp >> 24);
-    packet[6] = (uint8_t)(timestamp >> 32);
-    packet[7] = (uint8_t)(timestamp >> 40);
-    packet[8] = (uint8_t)(timestamp >> 48);
-    packet[9] = (uint8_t)(timestamp >> 56);
-    packet[10] = (uint8_t)(fbits >> 0);
-    packet[11] = (uint8_t)(fbits >> 8);
-    packet[12] = (uint8_t)(fbits >> 16);
-    packet[13] = (uint8_t)(fbits >> 24);
-    _va_emit_packet(packet, 14);
+    _va_send_data_event_packet(VA_EVENT_FLOAT_TRACE, id, fbits, timestamp);
 }
 
 void _va_send_user_toggle_event_packet(uint8_t id, VA_UserToggleState_t state, uint64_t timestamp)
 {
-    uint8_t packet[11];
-    packet[0] = VA_EVENT_USER_TOGGLE;
-    packet[1] = id;
-    packet[2] = (uint8_t)(timestamp >> 0);
-    packet[3] = (uint8_t)(timestamp >> 8);
-    packet[4] = (uint8_t)(timestamp >> 16);
-    packet[5] = (uint8_t)(timestamp >> 24);
-    packet[6] = (uint8_t)(timestamp >> 32);
-    packet[7] = (uint8_t)(timestamp >> 40);
-    packet[8] = (uint8_t)(timestamp >> 48);
-    packet[9] = (uint8_t)(timestamp >> 56);
-    packet[10] = (uint8_t)(state);
-    _va_emit_packet(packet, 11);
+    uint8_t state_byte = (uint8_t)state;
+    _va_send_packet(VA_LAYOUT_TOGGLE, VA_EVENT_USER_TOGGLE, id, &state_byte, NULL, timestamp);
 }
 
 void _va_send_notification_event_packet(uint8_t type_byte, uint8_t id, uint8_t other_id, uint32_t value, uint64_t timestamp)
 {
-    uint8_t packet[15];
-    packet[0] = type_byte;
-    packet[1] = id;
-    packet[2] = other_id;
-    packet[3] = (uint8_t)(timestamp >> 0);
-    packet[4] = (uint8_t)(timestamp >> 8);
-    packet[5] = (uint8_t)(timestamp >> 16);
-    packet[6] = (uint8_t)(timestamp >> 24);
-    packet[7] = (uint8_t)(timestamp >> 32);
-    packet[8] = (uint8_t)(timestamp >> 40);
-    packet[9] = (uint8_t)(timestamp >> 48);
-    packet[10] = (uint8_t)(timestamp >> 56);
-    packet[11] = (uint8_t)(value >> 0);
-    packet[12] = (uint8_t)(value >> 8);
-    packet[13] = (uint8_t)(value >> 16);
-    packet[14] = (uint8_t)(value >> 24);
-    _va_emit_packet(packet, 15);
+    _va_send_packet(VA_LAYOUT_NOTIFICATION, type_byte, id, &other_id, &value, timestamp);
 }
 
 void _va_send_mutex_contention_packet(uint8_t mutex_id, uint8_t waiting_task_id, uint8_t holder_task_id, uint64_t timestamp)
 {
-    uint8_t packet[12];
-    packet[0] = VA_EVENT_MUTEX_CONTENTION;
-    packet[1] = mutex_id;
-    packet[2] = waiting_task_id;
-    packet[3] = holder_task_id;
-    packet[4] = (uint8_t)(timestamp >> 0);
-    packet[5] = (uint8_t)(timestamp >> 8);
-    packet[6] = (uint8_t)(timestamp >> 16);
-    packet[7] = (uint8_t)(timestamp >> 24);
-    packet[8] = (uint8_t)(timestamp >> 32);
-    packet[9] = (uint8_t)(timestamp >> 40);
-    packet[10] = (uint8_t)(timestamp >> 48);
-    packet[11] = (uint8_t)(timestamp >> 56);
-    _va_emit_packet(packet, 12);
+    const uint8_t tasks[2] = {waiting_task_id, holder_task_id};
+    _va_send_packet(VA_LAYOUT_CONTENTION, VA_EVENT_MUTEX_CONTENTION, mutex_id, tasks, NULL, timestamp);
 }
 
 void _va_send_task_create_packet(uint8_t id, uint64_t timestamp, uint32_t priority, uint32_t base_priority, uint32_t stack_size)
 {
-    uint8_t packet[22];
-    packet[0] = VA_EVENT_TASK_CREATE;
-    packet[1] = id;
-    packet[2] = (uint8_t)(timestamp >> 0);
-    packet[3] = (uint8_t)(timestamp >> 8);
-    packet[4] = (uint8_t)(timestamp >> 16);
-    packet[5] = (uint8_t)(timestamp >> 24);
-    packet[6] = (uint8_t)(timestamp >> 32);
-    packet[7] = (uint8_t)(timestamp >> 40);
-    packet[8] = (uint8_t)(timestamp >> 48);
-    packet[9] = (uint8_t)(timestamp >> 56);
-    packet[10] = (uint8_t)(priority >> 0);
-    packet[11] = (uint8_t)(priority >> 8);
-    packet[12] = (uint8_t)(priority >> 16);
-    packet[13] = (uint8_t)(priority >> 24);
-    packet[14] = (uint8_t)(base_priority >> 0);
-    packet[15] = (uint8_t)(base_priority >> 8);
-    packet[16] = (uint8_t)(base_priority >> 16);
-    packet[17] = (uint8_t)(base_priority >> 24);
-    packet[18] = (uint8_t)(stack_size >> 0);
-    packet[19] = (uint8_t)(stack_size >> 8);
-    packet[20] = (uint8_t)(stack_size >> 16);
-    packet[21] = (uint8_t)(stack_size >> 24);
-    _va_emit_packet(packet, 22);
+    const uint32_t words[3] = {priority, base_priority, stack_size};
+    _va_send_packet(VA_LAYOUT_TASK_CREATE, VA_EVENT_TASK_CREATE, id, NULL, words, timestamp);
 }
 
 void _va_send_stack_usage_packet(uint8_t id, uint64_t timestamp, uint32_t stack_used, uint32_t stack_total)
 {
-    uint8_t packet[18];
-    packet[0] = VA_EVENT_TASK_STACK_USAGE;
-    packet[1] = id;
-    packet[2] = (uint8_t)(timestamp >> 0);
-    packet[3] = (uint8_t)(timestamp >> 8);
-    packet[4] = (uint8_t)(timestamp >> 16);
-    packet[5] = (uint8_t)(timestamp >> 24);
-    packet[6] = (uint8_t)(timestamp >> 32);
-    packet[7] = (uint8_t)(timestamp >> 40);
-    packet[8] = (uint8_t)(timestamp >> 48);
-    packet[9] = (uint8_t)(timestamp >> 56);
-    packet[10] = (uint8_t)(stack_used >> 0);
-    packet[11] = (uint8_t)(stack_used >> 8);
-    packet[12] = (uint8_t)(stack_used >> 16);
-    packet[13] = (uint8_t)(stack_used >> 24);
-    packet[14] = (uint8_t)(stack_total >> 0);
-    packet[15] = (uint8_t)(stack_total >> 8);
-    packet[16] = (uint8_t)(stack_total >> 16);
-    packet[17] = (uint8_t)(stack_total >> 24);
-    _va_emit_packet(packet, 18);
+    const uint32_t words[2] = {stack_used, stack_total};
+    _va_send_packet(VA_LAYOUT_STACK_USAGE, VA_EVENT_TASK_STACK_USAGE, id, NULL, words, timestamp);
 }
 
 void _va_send_data_event_packet(uint8_t type_byte, uint8_t id, uint32_t value, uint64_t timestamp)
 {
-    uint8_t packet[14];
-    packet[0] = type_byte;
-    packet[1] = id;
-    packet[2] = (uint8_t)(timestamp >> 0);
-    packet[3] = (uint8_t)(timestamp >> 8);
-    packet[4] = (uint8_t)(timestamp >> 16);
-    packet[5] = (uint8_t)(timestamp >> 24);
-    packet[6] = (uint8_t)(timestamp >> 32);
-    packet[7] = (uint8_t)(timestamp >> 40);
-    packet[8] = (uint8_t)(timestamp >> 48);
-    packet[9] = (uint8_t)(timestamp >> 56);
-    packet[10] = (uint8_t)(value >> 0);
-    packet[11] = (uint8_t)(value >> 8);
-    packet[12] = (uint8_t)(value >> 16);
-    packet[13] = (uint8_t)(value >> 24);
-    _va_emit_packet(packet, 14);
+    _va_send_short_packet(type_byte, id, timestamp, true, value);
 }
 
 void _va_send_heap_setup_packet(uint8_t id, const char *name, uint32_t totalSize)
 {
-    uint8_t name_len = (uint8_t)strlen(name);
-    if (name_len >= VA_MAX_TASK_NAME_LEN)
-    {
-        name_len = VA_MAX_TASK_NAME_LEN - 1;
-    }
-    uint8_t buf[7 + VA_MAX_TASK_NAME_LEN];
-    buf[0] = VA_SETUP_HEAP_INFO;
-    buf[1] = id;
-    buf[2] = (uint8_t)(totalSize >> 0);
-    buf[3] = (uint8_t)(totalSize >> 8);
-    buf[4] = (uint8_t)(totalSize >> 16);
-    buf[5] = (uint8_t)(totalSize >> 24);
-    buf[6] = name_len;
-    memcpy(&buf[7], name, name_len);
-    _va_emit_packet(buf, 7 + name_len);
+    uint8_t head[6] = {VA_SETUP_HEAP_INFO, id};
+    _va_put_u32(&head[2], totalSize);
+    _va_send_named_packet(head, sizeof(head), name);
+}
+
+#if VA_TRACE_USER_STRINGS
+/* Format strings can be longer than names: 2-byte length, like string events */
+static void _va_send_log_format_packet(uint8_t fmt_id, const char *fmt)
+{
+    uint32_t len = (uint32_t)strlen(fmt);
+    if (len > VA_MAX_LOG_STRING_LEN)
+        len = VA_MAX_LOG_STRING_LEN;
+
+    uint8_t buf[4 + VA_MAX_LOG_STRING_LEN];
+    buf[0] = VA_SETUP_LOG_FORMAT;
+    buf[1] = fmt_id;
+    buf[2] = (uint8_t)(len >> 0);
+    buf[3] = (uint8_t)(len >> 8);
+    memcpy(&buf[4], fmt, len);
+    _va_emit_packet(buf, 4 + len);
 }
+#endif
 
 /* ================================================================
  *  Timestamp
  * ================================================================ */
 
-uint64_t _va_get_timestamp(void)
+/* Lock-free 64-bit extension of DWT->CYCCNT.
+ *
+ * g_dwt_epoch packs the overflow count with the top bit of the last
+ * CYCCNT value any context observed.  A wrap shows up as that bit going
+ * from 1 to 0, and the new epoch is published with LDREX/STREX, so no
+ * interrupt masking is needed and nested ISRs are safe: exception entry
+ * and return clear the exclusive monitor, so a preempted update simply
+ * retries with a fresh CYCCNT.  If the epoch doesn't change (the common
+ * case) nothing is stored at all.
+ *
+ * Requirement: some context must call this at least once per half
+ * counter period (2^31 cycles, ~4.4 s at 480 MHz) — every event does,
+ * VA_TickOverflowCheck() covers idle periods.  With VA_NUM_CORES > 1 each
+ * core extends its own counter, so this holds per core. */
+static inline uint64_t _va_extend_cyccnt(volatile uint32_t *epoch_word)
 {
-    uint32_t high_part;
-    uint32_t low_part;
-    uint32_t primask_state = __get_PRIMASK();
-    __disable_irq();
+    uint32_t epoch, next, cyccnt, high;
 
-    uint32_t current_dwt = DWT->CYCCNT;
-    if (current_dwt < g_dwt_last_value)
+    do
     {
-        g_dwt_overflow_count++;
-    }
-    g_dwt_last_value = current_dwt;
-    high_part = g_dwt_overflow_count;
-    low_part = current_dwt;
-   
-    __set_PRIMASK(primask_state);
-    return (((uint64_t)high_part) << 32) | low_part;
+        epoch = __LDREXW(epoch_word);
+        cyccnt = DWT->CYCCNT;
+        high = epoch >> 1;
+        if ((epoch & 1u) && !(cyccnt >> 31))
+        {
+            high++;
+        }
+        next = (high << 1) | (cyccnt >> 31);
+        if (next == epoch)
+        {
+            __CLREX();
+            break;
+        }
+    } while (__STREXW(next, epoch_word) != 0u);
+
+    return (((uint64_t)high) << 32) | cyccnt;
+}
+
+uint64_t _va_get_timestamp(void)
+{
+#if VA_NUM_CORES > 1
+    /* The epoch must belong to the core whose CYCCNT is read: no migration
+     * in between. */
+    VA_CS_ENTER();
+    uint64_t timestamp = _va_extend_cyccnt(&g_dwt_epoch[VA_CORE_ID()]);
+    VA_CS_EXIT();
+    return timestamp;
+#else
+    return _va_extend_cyccnt(&g_dwt_epoch[0]);
+#endif
 }
 
 void VA_TickOverflowCheck(void)
@@ -547,19 +2499,52 @@ void VA_TickOverflowCheck(void)
     (void)_va_get_timestamp();
 }
 
-void VA_EmitSetupBundle(void)
-{
-    if (!VA_IS_INIT)
-        return;
-
-    VA_CS_ENTER();
+/* ================================================================
+ *  Setup bundle
+ *
+ *  The bundle is a sequence of entries: the header (sync marker, clock,
+ *  OS info), then every task, sync-object, user-trace and VA_Logf() format
+ *  slot, walked by
+ *  _va_bundle_cursor.  VA_EmitSetupBundle() walks it in one go.  With
+ *  VA_SETUP_BUNDLE_CHUNK > 0 periodic and requested bundles advance it a
+ *  few entries at a time instead — per emitted packet, or per VA_Drain()
+ *  call with the ring buffer — so no single hook pays for every map.  A
+ *  "GEN:<n>" info packet closes each completed cycle.
+ * ================================================================ */
+#define VA_BUNDLE_TASKS   1u
+#if VA_HAS_RTOS
+#define VA_BUNDLE_OBJECTS (VA_BUNDLE_TASKS + VA_MAX_TASKS)
+#define VA_BUNDLE_USER    (VA_BUNDLE_OBJECTS + VA_MAX_SYNC_OBJECTS)
+#else
+#define VA_BUNDLE_USER    VA_BUNDLE_TASKS
+#endif
+#define VA_BUNDLE_FORMATS (VA_BUNDLE_USER + VA_MAX_USER_EVENTS)
+#if VA_TRACE_USER_STRINGS
+#define VA_BUNDLE_END     (VA_BUNDLE_FORMATS + VA_MAX_LOG_FORMATS)
+#else
+#define VA_BUNDLE_END     VA_BUNDLE_FORMATS
+#endif
 
+static void _va_bundle_header(void)
+{
     _va_emit_packet(VA_SYNC_MARKER, sizeof(VA_SYNC_MARKER));
 
     char info_buf[40];
     _va_u32_to_str(info_buf, sizeof(info_buf), "CLK:", _va_cpu_freq);
     _va_send_setup_packet(VA_SETUP_INFO, 0, info_buf);
 
+#if VA_COMPACT_TIMESTAMPS
+    /* A host that attaches mid-run needs the encoding flag and an absolute
+     * base before it can decode any delta. */
+    _va_send_setup_packet(VA_SETUP_CONFIG_FLAGS, 0, "TS_DELTA");
+    _va_send_time_anchor(_va_get_timestamp());
+#endif
+#if VA_NUM_CORES > 1
+    /* Task-switch and ISR packets carry a trailing core byte */
+    _va_u32_to_str(info_buf, sizeof(info_buf), "CORES:", VA_NUM_CORES);
+    _va_send_setup_packet(VA_SETUP_CONFIG_FLAGS, 0, info_buf);
+#endif
+
 #if (VA_RTOS_SELECT == VA_RTOS_FREERTOS)
     _va_send_setup_packet(VA_SETUP_OS_INFO, 0, "FreeRTOS");
 #elif (VA_RTOS_SELECT == VA_RTOS_ZEPHYR)
@@ -567,10 +2552,17 @@ void VA_EmitSetupBundle(void)
 #else
     _va_send_setup_packet(VA_SETUP_OS_INFO, 0, "BareMetal");
 #endif
+}
+
+/* Emit one bundle entry; returns false for an empty slot. */
+static bool _va_bundle_entry(uint32_t entry)
+{
+    bool emitted = false;
 
 #if VA_HAS_RTOS
-    for (int i = 0; i < VA_MAX_TASKS; ++i)
+    if (entry < VA_BUNDLE_OBJECTS)
     {
+        uint32_t i = entry - VA_BUNDLE_TASKS;
         if (taskMap[i].active)
         {
             _va_send_setup_packet(VA_SETUP_TASK_MAP, taskMap[i].id, taskMap[i].name);
@@ -578,44 +2570,271 @@ void VA_EmitSetupBundle(void)
                                         taskMap[i].uxPriority,
                                         taskMap[i].uxBasePriority,
                                         taskMap[i].ulStackDepth);
+#if VA_CAPTURE_STACK_USAGE && VA_STACK_CHANGE_ONLY
+            /* Change-only sampling may not resend this for a long time */
+            if (taskMap[i].stack_last_reported != UINT32_MAX)
+            {
+                _va_send_stack_usage_packet(taskMap[i].id, _va_get_timestamp(),
+                                            taskMap[i].stack_last_reported,
+                                            taskMap[i].ulStackDepth);
+            }
+#endif
+            emitted = true;
         }
+        return emitted;
     }
 
-    for (int i = 0; i < VA_MAX_SYNC_OBJECTS; ++i)
+    if (entry < VA_BUNDLE_USER)
     {
+        uint32_t i = entry - VA_BUNDLE_OBJECTS;
         if (queueObjectMap[i].active)
         {
             _va_send_setup_packet(_va_get_setup_packet_type(queueObjectMap[i].type),
                                   queueObjectMap[i].id,
                                   queueObjectMap[i].name);
+            emitted = true;
+        }
+        return emitted;
+    }
+#endif
+
+#if VA_TRACE_USER_STRINGS
+    if (entry >= VA_BUNDLE_FORMATS)
+    {
+        uint32_t i = entry - VA_BUNDLE_FORMATS;
+        if (i < next_log_format)
+        {
+            _va_send_log_format_packet((uint8_t)(i + 1), logFormatMap[i].fmt);
+            emitted = true;
         }
+        return emitted;
     }
 #endif
 
     /* User trace + user event registrations (RTOS-independent): re-emit the
      * stored maps so hosts that attach mid-run (live attach, fused ETM+ITM
      * capture windows) resolve ids to real names instead of fallbacks. */
-    for (int i = 0; i < VA_MAX_USER_EVENTS; ++i)
+    uint32_t i = entry - VA_BUNDLE_USER;
+    if (userTraceMap[i].active)
+    {
+        if (userTraceMap[i].type == (uint8_t)VA_USER_TYPE_ISR)
+            _va_send_setup_packet(VA_SETUP_ISR_MAP, userTraceMap[i].id,
+                                  userTraceMap[i].name);
+        else
+            _va_send_user_setup_packet(userTraceMap[i].id, userTraceMap[i].type,
+                                       userTraceMap[i].name);
+        emitted = true;
+    }
+    if (userEventMap[i].active)
     {
-        if (userTraceMap[i].active)
+        _va_send_setup_packet(VA_SETUP_USER_EVENT_MAP, userEventMap[i].id,
+                              userEventMap[i].name);
+        emitted = true;
+    }
+    return emitted;
+}
+
+/* Advance the bundle by up to `budget` non-empty entries.  Caller holds
+ * the critical section.  Returns true once the cycle has completed. */
+static bool _va_bundle_step(uint32_t budget)
+{
+    _va_emitting_bundle = true;
+    while (budget > 0 && _va_bundle_cursor < VA_BUNDLE_END)
+    {
+        uint32_t entry = _va_bundle_cursor++;
+        if (entry == 0)
         {
-            if (userTraceMap[i].type == (uint8_t)VA_USER_TYPE_ISR)
-                _va_send_setup_packet(VA_SETUP_ISR_MAP, userTraceMap[i].id,
-                                      userTraceMap[i].name);
-            else
-                _va_send_user_setup_packet(userTraceMap[i].id, userTraceMap[i].type,
-                                           userTraceMap[i].name);
+            _va_bundle_header();
+            budget--;
         }
-        if (userEventMap[i].active)
+        else if (_va_bundle_entry(entry))
         {
-            _va_send_setup_packet(VA_SETUP_USER_EVENT_MAP, userEventMap[i].id,
-                                  userEventMap[i].name);
+            budget--;
         }
     }
 
+    bool done = (_va_bundle_cursor >= VA_BUNDLE_END);
+    if (done)
+    {
+        char gen_buf[24];
+        _va_u32_to_str(gen_buf, sizeof(gen_buf), "GEN:", _va_bundle_generation++);
+        _va_send_setup_packet(VA_SETUP_INFO, 0, gen_buf);
+        _va_bundle_cursor = 0;
+        _va_bundle_active = false;
+    }
+    _va_emitting_bundle = false;
+    return done;
+}
+
+void VA_EmitSetupBundle(void)
+{
+    if (!VA_IS_INIT)
+        return;
+
+    VA_CS_ENTER();
+    VA_SMP_LOCK();
+    _va_bundle_cursor = 0;
+    (void)_va_bundle_step(UINT32_MAX);
+    VA_SMP_UNLOCK();
+    VA_CS_EXIT();
+}
+
+void VA_RequestSetupBundle(void)
+{
+    if (!VA_IS_INIT)
+        return;
+#if VA_SETUP_BUNDLE_CHUNK > 0
+    VA_CS_ENTER();
+    VA_SMP_LOCK();
+    if (!_va_bundle_active)
+    {
+        _va_bundle_cursor = 0;
+        _va_bundle_active = true;
+    }
+    VA_SMP_UNLOCK();
     VA_CS_EXIT();
+#else
+    VA_EmitSetupBundle();
+#endif
+}
+
+/* ================================================================
+ *  Remote control (VA_REMOTE_CONTROL)
+ *
+ *  Commands arrive as COBS frames on a byte stream and are decoded one
+ *  byte at a time, so the RTT down-buffer, a UART receive interrupt or a
+ *  UDP datagram can all feed VA_ReceiveCommandBytes().  Bytes of a frame
+ *  that is too long or malformed are discarded up to the next 0x00.
+ * ================================================================ */
+#if VA_REMOTE_CONTROL
+
+#define VA_CMD_MAX_LEN 4u   /* longest command: VA_CMD_SET_ID */
+
+VA_Control_t _va_ctl;
+
+static uint8_t s_va_cmd[VA_CMD_MAX_LEN];
+static uint8_t s_va_cmd_len;
+static uint8_t s_va_cmd_left;   /* data bytes left in the current COBS block */
+static bool    s_va_cmd_zero;   /* the current block ends in an implicit 0x00 */
+static bool    s_va_cmd_bad;
+
+void VA_SetRecording(bool on)
+{
+    if (on)
+        _va_ctl.off = (uint8_t)(_va_ctl.off & ~VA_CTL_STOPPED);
+    else
+        _va_ctl.off = (uint8_t)(_va_ctl.off | VA_CTL_STOPPED);
+}
+
+void VA_SetClassEnabled(VA_TraceClass_t cls, bool on)
+{
+    if ((uint32_t)cls >= VA_CLASS_COUNT)
+        return;
+    if (on)
+        _va_ctl.off = (uint8_t)(_va_ctl.off & ~(1u << cls));
+    else
+        _va_ctl.off = (uint8_t)(_va_ctl.off | (1u << cls));
+}
+
+void VA_SetIdEnabled(VA_TraceClass_t cls, uint8_t id, bool on)
+{
+    if ((uint32_t)cls >= VA_CLASS_COUNT)
+        return;
+    if (on)
+        _va_ctl.id_off[cls][id >> 5] &= ~(1u << (id & 31u));
+    else
+        _va_ctl.id_off[cls][id >> 5] |= (1u << (id & 31u));
+}
+
+static void _va_run_command(const uint8_t *cmd, uint32_t length)
+{
+    switch (cmd[0])
+    {
+    case VA_CMD_START:
+        VA_SetRecording(true);
+        break;
+    case VA_CMD_STOP:
+        VA_SetRecording(false);
+        break;
+    case VA_CMD_SETUP_BUNDLE:
+        VA_RequestSetupBundle();
+        break;
+    case VA_CMD_SET_CLASSES:
+        if (length >= 2)
+        {
+            uint8_t keep = (uint8_t)(_va_ctl.off & VA_CTL_STOPPED);
+            _va_ctl.off = (uint8_t)(keep | (~cmd[1] & ((1u << VA_CLASS_COUNT) - 1u)));
+        }
+        break;
+    case VA_CMD_SET_ID:
+        if (length >= 4)
+            VA_SetIdEnabled((VA_TraceClass_t)cmd[1], cmd[2], cmd[3] != 0);
+        break;
+    case VA_CMD_SET_ALL_IDS:
+        if (length >= 3 && cmd[1] < VA_CLASS_COUNT)
+        {
+            for (uint32_t i = 0; i < 8; ++i)
+                _va_ctl.id_off[cmd[1]][i] = (cmd[2] != 0) ? 0u : 0xFFFFFFFFu;
+        }
+        break;
+    default:
+        break;   /* unknown command: ignore, a newer host may send it */
+    }
+}
+
+void VA_ReceiveCommandBytes(const uint8_t *data, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        uint8_t b = data[i];
+        if (b == 0x00)
+        {
+            if (!s_va_cmd_bad && s_va_cmd_left == 0 && s_va_cmd_len > 0)
+                _va_run_command(s_va_cmd, s_va_cmd_len);
+            s_va_cmd_len = 0;
+            s_va_cmd_left = 0;
+            s_va_cmd_zero = false;
+            s_va_cmd_bad = false;
+            continue;
+        }
+
+        uint32_t n = 1;   /* bytes this input byte adds to the command */
+        if (s_va_cmd_left == 0)
+        {
+            /* Code byte: closes the previous block, opens the next */
+            n = s_va_cmd_zero ? 1u : 0u;
+            s_va_cmd_zero = (b != 0xFF);
+            s_va_cmd_left = (uint8_t)(b - 1u);
+            b = 0x00;
+        }
+        else
+        {
+            s_va_cmd_left--;
+        }
+        if (n != 0)
+        {
+            if (s_va_cmd_len < VA_CMD_MAX_LEN)
+                s_va_cmd[s_va_cmd_len++] = b;
+            else
+                s_va_cmd_bad = true;
+        }
+    }
 }
 
+void VA_PollCommands(void)
+{
+#if VA_TRANSPORT_IS_JLINK
+    uint8_t buf[16];
+    unsigned n;
+    while ((n = SEGGER_RTT_Read(VA_RTT_CHANNEL, buf, sizeof(buf))) > 0)
+    {
+        VA_ReceiveCommandBytes(buf, n);
+    }
+#endif
+}
+
+#endif /* VA_REMOTE_CONTROL */
+
 static void _va_enable_dwt_counter(void)
 {
 #if (__ARM_ARCH >= 8)
@@ -627,38 +2846,54 @@ static void _va_enable_dwt_counter(void)
     DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 }
 
+#if VA_NUM_CORES > 1
+/* Each core has its own DWT: start it as close to VA_Init() as possible,
+ * since the host can only line the cores up by their counters. */
+void VA_InitCore(void)
+{
+    VA_CS_ENTER();
+    g_dwt_epoch[VA_CORE_ID()] = 0;
+    _va_enable_dwt_counter();
+    VA_CS_EXIT();
+}
+#endif
+
 /* ================================================================
  *  Generic task-map helpers
  * ================================================================ */
 
-uint8_t _va_find_task_id(void *handle)
+/* Fibonacci hash of a handle; the low bits of a pointer are alignment. */
+static inline uint32_t _va_hash_ptr(const void *handle, uint32_t slots)
 {
-    for (int i = 0; i < VA_MAX_TASKS; ++i)
-    {
-        if (taskMap[i].active && taskMap[i].handle == handle)
-        {
-            return taskMap[i].id;
-        }
-    }
-    return 0;
+    return ((uint32_t)((uintptr_t)handle >> 2) * 2654435761u >> 16) & (slots - 1u);
 }
 
 int _va_find_task_index(void *handle)
 {
-    for (int i = 0; i < VA_MAX_TASKS; ++i)
+    uint32_t h = _va_hash_ptr(handle, VA_TASK_HASH_SLOTS);
+    while (taskHash[h] != 0)
     {
-        if (taskMap[i].active && taskMap[i].handle == handle)
+        int i = taskHash[h] - 1;
+        if (taskMap[i].handle == handle)
         {
             return i;
         }
+        h = (h + 1u) & (VA_TASK_HASH_SLOTS - 1u);
     }
     return -1;
 }
 
+uint8_t _va_find_task_id(void *handle)
+{
+    int i = _va_find_task_index(handle);
+    return (i >= 0) ? taskMap[i].id : 0;
+}
+
 uint8_t _va_assign_task_id(void *handle, const char *name)
 {
     if (handle == NULL || name == NULL)
         return 0;
+    VA_SMP_LOCK();
     int empty_slot = -1;
     for (int i = 0; i < VA_MAX_TASKS; ++i)
     {
@@ -669,7 +2904,10 @@ uint8_t _va_assign_task_id(void *handle, const char *name)
         }
     }
     if (empty_slot == -1 || next_task_id == 0)
+    {
+        VA_SMP_UNLOCK();
         return 0;
+    }
 
     uint8_t new_id = next_task_id++;
     taskMap[empty_slot].active = true;
@@ -682,11 +2920,25 @@ uint8_t _va_assign_task_id(void *handle, const char *name)
     taskMap[empty_slot].uxPriority = g_task_uxPriority;
     taskMap[empty_slot].uxBasePriority = g_task_uxBasePriority;
     taskMap[empty_slot].ulStackDepth = g_task_ulStackDepth;
+#if VA_CAPTURE_STACK_USAGE && VA_STACK_CHANGE_ONLY
+    taskMap[empty_slot].stack_free_words = UINT32_MAX;
+    taskMap[empty_slot].stack_scan_cursor = 0;
+    taskMap[empty_slot].stack_last_reported = UINT32_MAX;
+#endif
 
     strncpy(taskMap[empty_slot].name, name, VA_MAX_TASK_NAME_LEN - 1);
     taskMap[empty_slot].name[VA_MAX_TASK_NAME_LEN - 1] = '\0';
 
+    uint32_t h = _va_hash_ptr(handle, VA_TASK_HASH_SLOTS);
+    while (taskHash[h] != 0)
+    {
+        h = (h + 1u) & (VA_TASK_HASH_SLOTS - 1u);
+    }
+    __DMB(); /* lookups on other cores don't take the lock */
+    taskHash[h] = (uint8_t)(empty_slot + 1);
+
     _va_send_setup_packet(VA_SETUP_TASK_MAP, new_id, taskMap[empty_slot].name);
+    VA_SMP_UNLOCK();
     return new_id;
 }
 
@@ -731,35 +2983,39 @@ uint8_t _va_get_setup_packet_type(VA_QueueObjectType_t type)
     }
 }
 
-uint8_t _va_find_queue_object_id(void *handle)
+int _va_find_queue_object_index(void *handle)
 {
-    for (int i = 0; i < VA_MAX_SYNC_OBJECTS; ++i)
+    uint32_t h = _va_hash_ptr(handle, VA_OBJECT_HASH_SLOTS);
+    while (queueObjectHash[h] != 0)
     {
-        if (queueObjectMap[i].active && queueObjectMap[i].handle == handle)
+        int i = queueObjectHash[h] - 1;
+        if (queueObjectMap[i].handle == handle)
         {
-            return queueObjectMap[i].id;
+            return i;
         }
+        h = (h + 1u) & (VA_OBJECT_HASH_SLOTS - 1u);
     }
-    return 0;
+    return -1;
+}
+
+uint8_t _va_find_queue_object_id(void *handle)
+{
+    int i = _va_find_queue_object_index(handle);
+    return (i >= 0) ? queueObjectMap[i].id : 0;
 }
 
 VA_QueueObjectType_t _va_get_stored_queue_object_type(void *handle)
 {
-    for (int i = 0; i < VA_MAX_SYNC_OBJECTS; ++i)
-    {
-        if (queueObjectMap[i].active && queueObjectMap[i].handle == handle)
-        {
-            return queueObjectMap[i].type;
-        }
-    }
-    return va_adapter_get_queue_object_type(handle);
+    int i = _va_find_queue_object_index(handle);
+    return (i >= 0) ? queueObjectMap[i].type : va_adapter_get_queue_object_type(handle);
 }
 
-uint8_t _va_assign_queue_object_id(void *handle, const char *name, VA_QueueObjectType_t type)
+static int _va_assign_queue_object_index(void *handle, const char *name, VA_QueueObjectType_t type)
 {
     if (handle == NULL)
-        return 0;
+        return -1;
 
+    VA_SMP_LOCK();
     int empty_slot = -1;
     for (int i = 0; i < VA_MAX_SYNC_OBJECTS; ++i)
     {
@@ -770,7 +3026,10 @@ uint8_t _va_assign_queue_object_id(void *handle, const char *name, VA_QueueObjec
         }
     }
     if (empty_slot == -1 || next_queue_object_id == 0)
-        return 0;
+    {
+        VA_SMP_UNLOCK();
+        return -1;
+    }
 
     uint8_t new_id = next_queue_object_id++;
     queueObjectMap[empty_slot].active = true;
@@ -788,9 +3047,45 @@ uint8_t _va_assign_queue_object_id(void *handle, const char *name, VA_QueueObjec
     }
     queueObjectMap[empty_slot].name[VA_MAX_TASK_NAME_LEN - 1] = '\0';
 
+    uint32_t h = _va_hash_ptr(handle, VA_OBJECT_HASH_SLOTS);
+    while (queueObjectHash[h] != 0)
+    {
+        h = (h + 1u) & (VA_OBJECT_HASH_SLOTS - 1u);
+    }
+    __DMB(); /* lookups on other cores don't take the lock */
+    queueObjectHash[h] = (uint8_t)(empty_slot + 1);
+
     _va_send_setup_packet(_va_get_setup_packet_type(type), new_id, queueObjectMap[empty_slot].name);
-    return new_id;
+    VA_SMP_UNLOCK();
+    return empty_slot;
+}
+
+uint8_t _va_assign_queue_object_id(void *handle, const char *name, VA_QueueObjectType_t type)
+{
+    int i = _va_assign_queue_object_index(handle, name, type);
+    return (i >= 0) ? queueObjectMap[i].id : 0;
+}
+
+#if VA_TRACE_QUEUES
+/* Map entry for a handle seen in a give/take/block hook, registering it
+ * with the adapter-detected type on first sight.  NULL if the map is full. */
+static VA_QueueObjectMapEntry_t *_va_lookup_queue_object(void *handle)
+{
+    int i = _va_find_queue_object_index(handle);
+    if (i < 0)
+    {
+        /* Look again under the lock: another core may have just added it */
+        VA_SMP_LOCK();
+        i = _va_find_queue_object_index(handle);
+        if (i < 0)
+            i = _va_assign_queue_object_index(handle, NULL, va_adapter_get_queue_object_type(handle));
+        VA_SMP_UNLOCK();
+        if (i < 0)
+            return NULL;
+    }
+    return &queueObjectMap[i];
 }
+#endif
 
 #endif /* VA_HAS_RTOS */
 
@@ -861,14 +3156,75 @@ void va_taskcreated(void *taskHandle, const char *name)
 #endif
 }
 
+#if VA_HAS_RTOS && VA_CAPTURE_STACK_USAGE && VA_STACK_CHANGE_ONLY
+/* Refine a task's stack watermark with at most VA_STACK_SCAN_BUDGET_WORDS
+ * word reads and send a stack usage packet only if it moved.
+ *
+ * stack_free_words only ever shrinks, and only to the index of a word seen
+ * to differ from the fill pattern, so it never under-reports usage.  The
+ * budget is spent first walking down from the current watermark (a stack
+ * that grows deeper is reported on the very next switch), then on a
+ * bottom-up sweep that resumes where the previous switch stopped and
+ * catches words written below an untouched gap, e.g. a large local array. */
+static void _va_sample_stack(VA_TaskMapEntry_t *task, void *taskHandle)
+{
+    VA_StackRegion_t region;
+    uint32_t stack_used;
+
+    if (va_adapter_get_stack_region(taskHandle, &region) && region.words > 0)
+    {
+        uint32_t budget = VA_STACK_SCAN_BUDGET_WORDS;
+        uint32_t free_words = task->stack_free_words;
+        if (free_words > region.words)
+            free_words = region.words;
+
+        while (budget > 0 && free_words > 0 && region.base[free_words - 1] != region.fill)
+        {
+            free_words--;
+            budget--;
+        }
+
+        uint32_t cursor = task->stack_scan_cursor;
+        while (budget > 0 && cursor < free_words)
+        {
+            if (region.base[cursor] != region.fill)
+            {
+                free_words = cursor;
+                break;
+            }
+            cursor++;
+            budget--;
+        }
+
+        task->stack_scan_cursor = (cursor >= free_words) ? 0 : cursor;
+        task->stack_free_words = free_words;
+        stack_used = (region.words - free_words) << region.unit_shift;
+    }
+    else
+    {
+        stack_used = va_adapter_calculate_stack_usage(taskHandle);
+    }
+
+    if (stack_used == task->stack_last_reported)
+        return;
+
+    uint32_t stack_total = va_adapter_get_total_stack_size(taskHandle);
+    if (stack_total > 0)
+    {
+        task->stack_last_reported = stack_used;
+        _va_send_stack_usage_packet(task->id, _va_get_timestamp(), stack_used, stack_total);
+    }
+}
+#endif
+
 void va_taskswitchedin(void *taskHandle)
 {
 #if VA_HAS_RTOS
     VA_CS_ENTER();
     uint8_t id = _va_find_task_id(taskHandle);
-    _va_send_event_packet(VA_EVENT_FLAG_START_END | VA_EVENT_TASK_SWITCH, id, _va_get_timestamp());
+    _va_send_core_event_packet(VA_EVENT_FLAG_START_END | VA_EVENT_TASK_SWITCH, id, _va_get_timestamp());
 
-#if VA_CAPTURE_STACK_USAGE
+#if VA_CAPTURE_STACK_USAGE && !VA_STACK_CHANGE_ONLY
     if (id != 0)
     {
         uint32_t stack_used = va_adapter_calculate_stack_usage(taskHandle);
@@ -889,10 +3245,23 @@ void va_taskswitchedout(void *taskHandle)
 {
 #if VA_HAS_RTOS
     VA_CS_ENTER();
+#if VA_CAPTURE_STACK_USAGE && VA_STACK_CHANGE_ONLY
+    int idx = _va_find_task_index(taskHandle);
+    uint8_t id = (idx >= 0) ? taskMap[idx].id : 0;
+    _va_send_core_event_packet(VA_EVENT_TASK_SWITCH, id, _va_get_timestamp());
+
+    /* The watermark can only move while the task runs, so switch-out is
+     * the one place it needs to be looked at. */
+    if (idx >= 0)
+    {
+        _va_sample_stack(&taskMap[idx], taskHandle);
+    }
+#else
     uint8_t id = _va_find_task_id(taskHandle);
-    _va_send_event_packet(VA_EVENT_TASK_SWITCH, id, _va_get_timestamp());
+    _va_send_core_event_packet(VA_EVENT_TASK_SWITCH, id, _va_get_timestamp());
+#endif
 
-#if VA_CAPTURE_STACK_USAGE
+#if VA_CAPTURE_STACK_USAGE && !VA_STACK_CHANGE_ONLY
     if (id != 0)
     {
         uint32_t stack_used = va_adapter_calculate_stack_usage(taskHandle);
@@ -921,7 +3290,7 @@ void VA_LogISRStart(uint8_t isrId)
         VA_CS_EXIT();
         return;
     }
-    _va_send_event_packet(VA_EVENT_FLAG_START_END | VA_EVENT_ISR, isrId, _va_get_timestamp());
+    _va_send_core_event_packet(VA_EVENT_FLAG_START_END | VA_EVENT_ISR, isrId, _va_get_timestamp());
     VA_CS_EXIT();
 }
 
@@ -933,7 +3302,7 @@ void VA_LogISREnd(uint8_t isrId)
         VA_CS_EXIT();
         return;
     }
-    _va_send_event_packet(VA_EVENT_ISR, isrId, _va_get_timestamp());
+    _va_send_core_event_packet(VA_EVENT_ISR, isrId, _va_get_timestamp());
     VA_CS_EXIT();
 }
 
@@ -980,23 +3349,244 @@ void VA_RegisterUserTrace(uint8_t id, const char *name, VA_UserTraceType_t type)
     VA_CS_EXIT();
 }
 
+#if VA_TRACE_USER_TRACES
+#if VA_TRACE_FILTERS
+/* ================================================================
+ *  Value-trace filters (VA_TRACE_FILTERS)
+ *
+ *  A sample within the deadband of the last one sent is held back as
+ *  `held`; when a changed sample goes out, the held one is sent first with
+ *  its own timestamp, so the host draws the step where it happened.
+ *  Changed samples are then rate-limited by the minimum interval and the
+ *  decimation count; those are dropped, not held.
+ * ================================================================ */
+typedef struct
+{
+    uint8_t  id;                /* 0 = free */
+    uint8_t  held_type;         /* type byte of the held sample, 0 = none */
+    uint16_t decimate;
+    uint16_t skipped;           /* changed samples dropped since the last sent */
+    bool     sent;              /* last_value is valid */
+    float    deadband;
+    float    deadband_frac;
+    uint32_t min_interval;
+    uint32_t last_value;        /* raw packet value: int32, float bits or u32 */
+    uint32_t held_value;
+    uint64_t last_ts;
+    uint64_t held_ts;
+} VA_TraceFilterEntry_t;
+
+static VA_TraceFilterEntry_t s_va_filters[VA_MAX_TRACE_FILTERS];
+static uint32_t              s_va_filtered_ids[8];   /* bit per id: has a filter */
+
+static inline float _va_fabs(float f)
+{
+    return (f < 0.0f) ? -f : f;
+}
+
+/* |value| and |value - ref| of two raw packet values, as floats */
+static void _va_filter_distance(uint8_t type_byte, uint32_t value, uint32_t ref,
+                                float *dist, float *mag)
+{
+    if (type_byte == VA_EVENT_FLOAT_TRACE)
+    {
+        float v, r;
+        memcpy(&v, &value, sizeof(v));
+        memcpy(&r, &ref, sizeof(r));
+        *dist = _va_fabs(v - r);
+        *mag = _va_fabs(r);
+    }
+    else if (type_byte == VA_EVENT_COUNTER)
+    {
+        *dist = (float)((value > ref) ? value - ref : ref - value);
+        *mag = (float)ref;
+    }
+    else
+    {
+        int64_t d = (int64_t)(int32_t)value - (int32_t)ref;
+        *dist = (float)((d < 0) ? -d : d);
+        *mag = _va_fabs((float)(int32_t)ref);
+    }
+}
+
+/* Whether a sample should be sent.  May send the held sample first.
+ * Call inside VA_CS_ENTER()/VA_CS_EXIT(). */
+static bool _va_filter_pass(uint8_t type_byte, uint8_t id, uint32_t value, uint64_t timestamp)
+{
+    if (((s_va_filtered_ids[id >> 5] >> (id & 31u)) & 1u) == 0u)
+        return true;
+
+    VA_TraceFilterEntry_t *f = NULL;
+    for (uint32_t i = 0; i < VA_MAX_TRACE_FILTERS; ++i)
+    {
+        if (s_va_filters[i].id == id)
+        {
+            f = &s_va_filters[i];
+            break;
+        }
+    }
+    if (f == NULL)
+        return true;
+
+    bool pass = true;
+    VA_SMP_LOCK();
+    if (f->sent)
+    {
+        float dist, mag;
+        _va_filter_distance(type_byte, value, f->last_value, &dist, &mag);
+        float band = f->deadband;
+        if (f->deadband_frac * mag > band)
+            band = f->deadband_frac * mag;
+
+        if (dist <= band)
+        {
+            f->held_type = type_byte;
+            f->held_value = value;
+            f->held_ts = timestamp;
+            pass = false;
+        }
+        else if ((f->min_interval != 0u && timestamp - f->last_ts < f->min_interval) ||
+                 (f->decimate > 1u && ++f->skipped < f->decimate))
+        {
+            pass = false;
+        }
+    }
+
+    if (pass)
+    {
+        if (f->held_type != 0u)
+        {
+            _va_send_data_event_packet(f->held_type, id, f->held_value, f->held_ts);
+            f->held_type = 0;
+        }
+        f->sent = true;
+        f->skipped = 0;
+        f->last_value = value;
+        f->last_ts = timestamp;
+    }
+    VA_SMP_UNLOCK();
+    return pass;
+}
+
+void VA_RegisterUserTraceEx(uint8_t id, const char *name, VA_UserTraceType_t type,
+                            const VA_TraceFilter_t *filter)
+{
+    VA_RegisterUserTrace(id, name, type);
+    if (id == 0 || name == NULL)
+        return;
+
+    VA_CS_ENTER();
+    VA_SMP_LOCK();
+    int slot = -1;
+    for (int i = 0; i < VA_MAX_TRACE_FILTERS; ++i)
+    {
+        if (s_va_filters[i].id == id) { slot = i; break; }
+        if (slot < 0 && s_va_filters[i].id == 0) slot = i;
+    }
+    if (filter == NULL)
+    {
+        s_va_filtered_ids[id >> 5] &= ~(1u << (id & 31u));
+        if (slot >= 0 && s_va_filters[slot].id == id)
+            s_va_filters[slot].id = 0;
+    }
+    else if (slot >= 0) /* full table: the trace stays unfiltered */
+    {
+        VA_TraceFilterEntry_t *f = &s_va_filters[slot];
+        memset(f, 0, sizeof(*f));
+        f->deadband = filter->deadband;
+        f->deadband_frac = filter->deadbandPct / 100.0f;
+        f->min_interval = filter->minIntervalCycles;
+        f->decimate = filter->decimate;
+        f->id = id;
+        s_va_filtered_ids[id >> 5] |= 1u << (id & 31u);
+    }
+    VA_SMP_UNLOCK();
+    VA_CS_EXIT();
+}
+#endif /* VA_TRACE_FILTERS */
+
+/* Value samples of VA_LogTrace, VA_LogTraceFloat and VA_LogCounter */
+static void _va_send_trace_value(uint8_t type_byte, uint8_t id, uint32_t value)
+{
+    uint64_t ts = _va_get_timestamp();
+#if VA_TRACE_FILTERS
+    if (!_va_filter_pass(type_byte, id, value, ts))
+        return;
+#endif
+    _va_send_data_event_packet(type_byte, id, value, ts);
+}
+
 void VA_LogTrace(uint8_t id, int32_t value)
 {
     VA_CS_ENTER();
-    _va_send_user_event_packet(id, value, _va_get_timestamp());
+    _va_send_trace_value(VA_EVENT_USER_TRACE, id, (uint32_t)value);
     VA_CS_EXIT();
 }
 
 void VA_LogTraceFloat(uint8_t id, float value)
 {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
     VA_CS_ENTER();
-    _va_send_float_event_packet(id, value, _va_get_timestamp());
+    _va_send_trace_value(VA_EVENT_FLOAT_TRACE, id, bits);
     VA_CS_EXIT();
 }
 
+/* One packet per VA_MAX_TRACE_BLOCK_BYTES of samples instead of one per
+ * sample.  The packet timestamp is the time of its first sample; the call is
+ * taken as the time of the last sample, so earlier samples are back-dated by
+ * whole periods.  Each chunk gets its own short critical section. */
+void VA_LogTraceBlock(uint8_t id, VA_SampleType_t type, const void *samples,
+                      uint16_t count, uint32_t samplePeriodCycles)
+{
+    if (samples == NULL || count == 0 || !_va_ctl_allows(VA_CLASS_USER, id))
+        return;
+
+    uint32_t sampleSize = (type == VA_SAMPLE_INT16) ? 2u : 4u;
+    uint32_t perPacket = (VA_MAX_TRACE_BLOCK_BYTES) / sampleSize;
+    if (perPacket == 0)
+        return;
+
+    const uint8_t *src = (const uint8_t *)samples;
+    uint64_t start = 0;
+    uint32_t done = 0;
+    while (done < count)
+    {
+        uint32_t chunk = count - done;
+        if (chunk > perPacket)
+            chunk = perPacket;
+
+        VA_CS_ENTER();
+        if (done == 0)
+        {
+            uint64_t now = _va_get_timestamp();
+            uint64_t span = (uint64_t)(count - 1u) * samplePeriodCycles;
+            start = (now > span) ? now - span : 0;
+        }
+
+        uint8_t buf[9 + VA_TS_MAX_BYTES + VA_MAX_TRACE_BLOCK_BYTES];
+        uint32_t n = 0;
+        buf[n++] = VA_EVENT_TRACE_BLOCK;
+        buf[n++] = id;
+        n += _va_put_timestamp(&buf[n], start + (uint64_t)done * samplePeriodCycles);
+        buf[n++] = (uint8_t)type;
+        buf[n++] = (uint8_t)(chunk >> 0);
+        buf[n++] = (uint8_t)(chunk >> 8);
+        n += _va_put_u32(&buf[n], samplePeriodCycles);
+        /* Cortex-M is little-endian: samples already have their wire layout. */
+        memcpy(&buf[n], &src[done * sampleSize], chunk * sampleSize);
+        _va_emit_packet(buf, n + chunk * sampleSize);
+        VA_CS_EXIT();
+
+        done += chunk;
+    }
+}
+#endif
+
+#if VA_TRACE_USER_STRINGS
 void VA_LogString(uint8_t id, const char *msg)
 {
-    if (!msg) return;
+    if (!msg || !_va_ctl_allows(VA_CLASS_LOG, id)) return;
     uint16_t len = (uint16_t)strlen(msg);
     if (len == 0) return;
     if (len > VA_MAX_LOG_STRING_LEN) len = VA_MAX_LOG_STRING_LEN;
@@ -1004,25 +3594,275 @@ void VA_LogString(uint8_t id, const char *msg)
     VA_CS_ENTER();
     uint64_t ts = _va_get_timestamp();
 
-    uint8_t buf[12 + VA_MAX_LOG_STRING_LEN];
-    buf[0] = VA_EVENT_STRING_EVENT;
-    buf[1] = id;
-    buf[2]  = (uint8_t)(ts >> 0);
-    buf[3]  = (uint8_t)(ts >> 8);
-    buf[4]  = (uint8_t)(ts >> 16);
-    buf[5]  = (uint8_t)(ts >> 24);
-    buf[6]  = (uint8_t)(ts >> 32);
-    buf[7]  = (uint8_t)(ts >> 40);
-    buf[8]  = (uint8_t)(ts >> 48);
-    buf[9]  = (uint8_t)(ts >> 56);
-    buf[10] = (uint8_t)(len >> 0);
-    buf[11] = (uint8_t)(len >> 8);
-    memcpy(&buf[12], msg, len);
-
-    _va_emit_packet(buf, 12 + len);
+    uint8_t buf[4 + VA_TS_MAX_BYTES + VA_MAX_LOG_STRING_LEN];
+    uint32_t n = 0;
+    buf[n++] = VA_EVENT_STRING_EVENT;
+    buf[n++] = id;
+    n += _va_put_timestamp(&buf[n], ts);
+    buf[n++] = (uint8_t)(len >> 0);
+    buf[n++] = (uint8_t)(len >> 8);
+    memcpy(&buf[n], msg, len);
+
+    _va_emit_packet(buf, n + len);
+    VA_CS_EXIT();
+}
+
+/* ================================================================
+ *  Deferred-format logging (VA_Logf)
+ *
+ *  The target never formats: the first call with a given format string
+ *  interns it (id + argument kinds, sent as a VA_SETUP_LOG_FORMAT packet)
+ *  and every call sends [fmt id][args len][args] for the host to format.
+ *  Arguments are packed little-endian: integers and pointers as 4 or 8
+ *  bytes, floating point as a 4-byte float, %s as [len 1B][bytes].
+ * ================================================================ */
+#define VA_LOGF_MAX_ARGS      8u
+#define VA_LOGF_MAX_ARG_BYTES ((VA_MAX_LOG_STRING_LEN) < 255 ? (VA_MAX_LOG_STRING_LEN) : 255)
+
+#define VA_LOGF_ARG_I32   1u
+#define VA_LOGF_ARG_I64   2u
+#define VA_LOGF_ARG_DBL   3u
+#define VA_LOGF_ARG_LDBL  4u
+#define VA_LOGF_ARG_STR   5u
+#define VA_LOGF_ARG_PTR   6u
+
+/* Argument kinds of a printf format, VA_LOGF_ARG_* packed 4 bits each.
+ * Parsing stops at VA_LOGF_MAX_ARGS or an unknown conversion. */
+static uint32_t _va_logf_parse(const char *fmt)
+{
+    uint32_t sig = 0;
+    uint32_t argc = 0;
+
+#define VA_LOGF_ADD(kind)                         \
+    do                                            \
+    {                                             \
+        if (argc == VA_LOGF_MAX_ARGS)             \
+            return sig;                           \
+        sig |= (uint32_t)(kind) << (4u * argc++); \
+    } while (0)
+
+    while (*fmt)
+    {
+        if (*fmt++ != '%')
+            continue;
+        if (*fmt == '%')
+        {
+            fmt++;
+            continue;
+        }
+
+        while (*fmt == '-' || *fmt == '+' || *fmt == ' ' || *fmt == '#' || *fmt == '0')
+            fmt++;
+        if (*fmt == '*')
+        {
+            VA_LOGF_ADD(VA_LOGF_ARG_I32);
+            fmt++;
+        }
+        while (*fmt >= '0' && *fmt <= '9')
+            fmt++;
+        if (*fmt == '.')
+        {
+            fmt++;
+            if (*fmt == '*')
+            {
+                VA_LOGF_ADD(VA_LOGF_ARG_I32);
+                fmt++;
+            }
+            while (*fmt >= '0' && *fmt <= '9')
+                fmt++;
+        }
+
+        uint32_t size = sizeof(int);
+        bool long_double = false;
+        switch (*fmt)
+        {
+        case 'h':
+            fmt += (fmt[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            if (fmt[1] == 'l')
+            {
+                size = sizeof(long long);
+                fmt += 2;
+            }
+            else
+            {
+                size = sizeof(long);
+                fmt++;
+            }
+            break;
+        case 'j': size = sizeof(long long); fmt++; break;
+        case 'z': size = sizeof(size_t);    fmt++; break;
+        case 't': size = sizeof(ptrdiff_t); fmt++; break;
+        case 'L': long_double = true;       fmt++; break;
+        default: break;
+        }
+
+        switch (*fmt++)
+        {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            VA_LOGF_ADD(size > 4u ? VA_LOGF_ARG_I64 : VA_LOGF_ARG_I32);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            VA_LOGF_ADD(long_double ? VA_LOGF_ARG_LDBL : VA_LOGF_ARG_DBL);
+            break;
+        case 's':
+            VA_LOGF_ADD(VA_LOGF_ARG_STR);
+            break;
+        case 'p': case 'n':
+            VA_LOGF_ADD(VA_LOGF_ARG_PTR);
+            break;
+        default:
+            return sig; /* can't know what the remaining arguments are */
+        }
+    }
+#undef VA_LOGF_ADD
+    return sig;
+}
+
+static int _va_find_log_format(const char *fmt)
+{
+    uint32_t h = _va_hash_ptr(fmt, VA_FORMAT_HASH_SLOTS);
+    while (logFormatHash[h] != 0)
+    {
+        int i = logFormatHash[h] - 1;
+        if (logFormatMap[i].fmt == fmt)
+        {
+            return i;
+        }
+        h = (h + 1u) & (VA_FORMAT_HASH_SLOTS - 1u);
+    }
+    return -1;
+}
+
+/* Index of `fmt` in the format table, adding and announcing it on first
+ * use.  -1 if the table is full. */
+static int _va_intern_log_format(const char *fmt)
+{
+    int i = _va_find_log_format(fmt);
+    if (i >= 0)
+        return i;
+
+    uint32_t sig = _va_logf_parse(fmt);
+
+    VA_CS_ENTER();
+    VA_SMP_LOCK();
+    i = _va_find_log_format(fmt);  /* an ISR or another core may have won */
+    if (i < 0 && next_log_format < VA_MAX_LOG_FORMATS)
+    {
+        i = next_log_format;
+        logFormatMap[i].fmt = fmt;
+        logFormatMap[i].sig = sig;
+
+        uint32_t h = _va_hash_ptr(fmt, VA_FORMAT_HASH_SLOTS);
+        while (logFormatHash[h] != 0)
+        {
+            h = (h + 1u) & (VA_FORMAT_HASH_SLOTS - 1u);
+        }
+        __DMB(); /* lookups don't take the lock */
+        logFormatHash[h] = (uint8_t)(i + 1);
+        next_log_format++;
+
+        _va_send_log_format_packet((uint8_t)(i + 1), fmt);
+    }
+    VA_SMP_UNLOCK();
+    VA_CS_EXIT();
+    return i;
+}
+
+void VA_VLogf(uint8_t id, const char *fmt, va_list args)
+{
+    if (!VA_IS_INIT || fmt == NULL || !_va_ctl_allows(VA_CLASS_LOG, id))
+        return;
+
+    int idx = _va_intern_log_format(fmt);
+    if (idx < 0)
+    {
+        VA_LogString(id, fmt); /* table full: at least show the unformatted text */
+        return;
+    }
+
+    /* Pack outside the critical section; only the timestamp and the emit
+     * need to be atomic. */
+    uint8_t packed[VA_LOGF_MAX_ARG_BYTES];
+    uint32_t a = 0;
+    for (uint32_t sig = logFormatMap[idx].sig; sig != 0; sig >>= 4)
+    {
+        uint32_t kind = sig & 0xFu;
+        if (kind == VA_LOGF_ARG_STR)
+        {
+            const char *s = va_arg(args, const char *);
+            if (s == NULL)
+                s = "(null)";
+            if (a + 1u > VA_LOGF_MAX_ARG_BYTES)
+                break;
+            uint32_t room = VA_LOGF_MAX_ARG_BYTES - a - 1u;
+            uint32_t len = 0;
+            while (len < room && s[len] != '\0')
+                len++;
+            packed[a++] = (uint8_t)len;
+            memcpy(&packed[a], s, len);
+            a += len;
+            continue;
+        }
+
+        uint32_t width = (kind == VA_LOGF_ARG_I64) ? 8u : 4u;
+        if (a + width > VA_LOGF_MAX_ARG_BYTES)
+            break; /* truncated: the host shows the missing arguments as such */
+
+        switch (kind)
+        {
+        case VA_LOGF_ARG_I64:
+            a += _va_put_u64(&packed[a], (uint64_t)va_arg(args, long long));
+            break;
+        case VA_LOGF_ARG_DBL:
+        {
+            float f = (float)va_arg(args, double);
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            a += _va_put_u32(&packed[a], bits);
+            break;
+        }
+        case VA_LOGF_ARG_LDBL:
+        {
+            float f = (float)va_arg(args, long double);
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            a += _va_put_u32(&packed[a], bits);
+            break;
+        }
+        case VA_LOGF_ARG_PTR:
+            a += _va_put_u32(&packed[a], (uint32_t)(uintptr_t)va_arg(args, void *));
+            break;
+        default:
+            a += _va_put_u32(&packed[a], (uint32_t)va_arg(args, int));
+            break;
+        }
+    }
+
+    VA_CS_ENTER();
+    uint8_t buf[4 + VA_TS_MAX_BYTES + VA_LOGF_MAX_ARG_BYTES];
+    uint32_t n = 0;
+    buf[n++] = VA_EVENT_LOG_FORMAT;
+    buf[n++] = id;
+    n += _va_put_timestamp(&buf[n], _va_get_timestamp());
+    buf[n++] = (uint8_t)(idx + 1);
+    buf[n++] = (uint8_t)a;
+    memcpy(&buf[n], packed, a);
+    _va_emit_packet(buf, n + a);
     VA_CS_EXIT();
 }
 
+void VA_Logf(uint8_t id, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    VA_VLogf(id, fmt, args);
+    va_end(args);
+}
+#endif
+
+#if VA_TRACE_USER_TRACES
 void VA_LogToggle(uint8_t id, bool state)
 {
     VA_CS_ENTER();
@@ -1040,21 +3880,25 @@ void VA_LogGPIO(uint8_t id, bool state)
 void VA_LogCounter(uint8_t id, uint32_t value)
 {
     VA_CS_ENTER();
-    _va_send_data_event_packet(VA_EVENT_COUNTER, id, value, _va_get_timestamp());
+    _va_send_trace_value(VA_EVENT_COUNTER, id, value);
     VA_CS_EXIT();
 }
+#endif
 
+#if VA_TRACE_HEAP
 void VA_LogHeap(uint8_t id, uint32_t usedBytes)
 {
     VA_CS_ENTER();
     _va_send_data_event_packet(VA_EVENT_HEAP, id, usedBytes, _va_get_timestamp());
     VA_CS_EXIT();
 }
+#endif
 
 /* ================================================================
  *  Sleep enter/exit (k_sleep, k_msleep, k_usleep)
  * ================================================================ */
 
+#if VA_TRACE_SLEEP
 void va_logSleepEnter(void *taskHandle)
 {
     VA_CS_ENTER();
@@ -1072,11 +3916,13 @@ void va_logSleepExit(void *taskHandle)
         _va_send_event_packet(VA_EVENT_SLEEP, id, _va_get_timestamp());
     VA_CS_EXIT();
 }
+#endif
 
 /* ================================================================
  *  PM (power management) suspend enter/exit
  * ================================================================ */
 
+#if VA_TRACE_PM
 /* Sentinel handle used as the sync-object pointer for PM events.
    Using a static variable's address guarantees a unique, stable value. */
 static uint8_t _va_pm_sentinel;
@@ -1105,6 +3951,7 @@ void va_logPMSuspendExit(uint8_t state)
     VA_CS_EXIT();
 #endif
 }
+#endif
 
 void VA_RegisterGPIO(uint8_t id, const char *name)
 {
@@ -1134,6 +3981,7 @@ void VA_RegisterHeap(uint8_t id, const char *name, uint32_t totalSize)
  *  Task notification hooks
  * ================================================================ */
 
+#if VA_TRACE_NOTIFY
 void va_logtasknotifygive(void *srcHandle, void *destHandle, uint32_t value)
 {
 #if VA_HAS_RTOS
@@ -1181,6 +4029,7 @@ void va_logtasknotifytake(void *taskHandle, uint32_t value)
     VA_UNUSED(value);
 #endif
 }
+#endif
 
 /* ================================================================
  *  Queue / sync-object event hooks
@@ -1199,15 +4048,7 @@ void va_updateQueueObjectType(void *queueObject, const char *typeHint)
 
     VA_CS_ENTER();
 
-    int idx = -1;
-    for (int i = 0; i < VA_MAX_SYNC_OBJECTS; ++i)
-    {
-        if (queueObjectMap[i].active && queueObjectMap[i].handle == queueObject)
-        {
-            idx = i;
-            break;
-        }
-    }
+    int idx = _va_find_queue_object_index(queueObject);
 
     if (idx >= 0)
     {
@@ -1369,6 +4210,7 @@ void va_logQueueObjectCreateWithType(void *queueObject, const char *typeHint)
 #endif
 }
 
+#if VA_TRACE_QUEUES
 void va_logQueueObjectGive(void *queueObject, uint32_t timeout)
 {
     VA_UNUSED(timeout);
@@ -1377,15 +4219,11 @@ void va_logQueueObjectGive(void *queueObject, uint32_t timeout)
         return;
 
     VA_CS_ENTER();
-    uint8_t id = _va_find_queue_object_id(queueObject);
-    if (id == 0)
-    {
-        VA_QueueObjectType_t type = va_adapter_get_queue_object_type(queueObject);
-        id = _va_assign_queue_object_id(queueObject, NULL, type);
-    }
+    VA_QueueObjectMapEntry_t *obj = _va_lookup_queue_object(queueObject);
+    uint8_t id = obj ? obj->id : 0;
 
     uint8_t event_type;
-    VA_QueueObjectType_t type = _va_get_stored_queue_object_type(queueObject);
+    VA_QueueObjectType_t type = obj ? obj->type : va_adapter_get_queue_object_type(queueObject);
     switch (type)
     {
     case VA_OBJECT_TYPE_MUTEX:
@@ -1421,15 +4259,11 @@ void va_logQueueObjectTake(void *queueObject, uint32_t timeout)
 
     VA_CS_ENTER();
     VA_UNUSED(timeout);
-    uint8_t id = _va_find_queue_object_id(queueObject);
-    if (id == 0)
-    {
-        VA_QueueObjectType_t type = va_adapter_get_queue_object_type(queueObject);
-        id = _va_assign_queue_object_id(queueObject, NULL, type);
-    }
+    VA_QueueObjectMapEntry_t *obj = _va_lookup_queue_object(queueObject);
+    uint8_t id = obj ? obj->id : 0;
 
     uint8_t event_type;
-    VA_QueueObjectType_t type = _va_get_stored_queue_object_type(queueObject);
+    VA_QueueObjectType_t type = obj ? obj->type : va_adapter_get_queue_object_type(queueObject);
 
     switch (type)
     {
@@ -1469,14 +4303,10 @@ void va_logQueueObjectBlocking(void *queueObject)
 
     VA_CS_ENTER();
 
-    uint8_t id = _va_find_queue_object_id(queueObject);
-    if (id == 0)
-    {
-        VA_QueueObjectType_t type = va_adapter_get_queue_object_type(queueObject);
-        id = _va_assign_queue_object_id(queueObject, NULL, type);
-    }
+    VA_QueueObjectMapEntry_t *obj = _va_lookup_queue_object(queueObject);
+    uint8_t id = obj ? obj->id : 0;
 
-    VA_QueueObjectType_t type = _va_get_stored_queue_object_type(queueObject);
+    VA_QueueObjectType_t type = obj ? obj->type : va_adapter_get_queue_object_type(queueObject);
 
     if (type == VA_OBJECT_TYPE_MUTEX || type == VA_OBJECT_TYPE_RECURSIVE_MUTEX)
     {
@@ -1488,11 +4318,13 @@ void va_logQueueObjectBlocking(void *queueObject)
     VA_UNUSED(queueObject);
 #endif
 }
+#endif
 
 /* ================================================================
  *  Heap alloc / free tracing
  * ================================================================ */
 
+#if VA_TRACE_HEAP
 void va_logHeapAlloc(void *heapObject, uint32_t allocBytes)
 {
 #if VA_HAS_RTOS
@@ -1534,6 +4366,7 @@ void va_logHeapFree(void *heapObject, uint32_t allocatedBytes)
     VA_UNUSED(allocatedBytes);
 #endif
 }
+#endif
 
 /* ================================================================
  *  User Event Logging
@@ -1556,6 +4389,7 @@ void VA_RegisterUserFunction(uint8_t id, const char *name)
     VA_RegisterUserEvent(id, name);
 }
 
+#if VA_TRACE_USER_EVENTS
 void VA_LogEvent(uint8_t id, bool state)
 {
     VA_CS_ENTER();
@@ -1565,7 +4399,12 @@ void VA_LogEvent(uint8_t id, bool state)
         return;
     }
     uint8_t event_flags = (state == USER_EVENT_START) ? (VA_EVENT_FLAG_START_END | VA_EVENT_USER_EVENT) : VA_EVENT_USER_EVENT;
+#if VA_INLINE_FAST_PATH
+    if (_va_ctl_allows(VA_CLASS_USER, id))
+        _va_fast_event(event_flags, id, _va_get_timestamp());
+#else
     _va_send_event_packet(event_flags, id, _va_get_timestamp());
+#endif
     VA_CS_EXIT();
 }
 
@@ -1573,6 +4412,7 @@ void VA_LogUserEvent(uint8_t id, bool state)
 {
     VA_LogEvent(id, state);
 }
+#endif
 
 /* ================================================================
  *  Initialization
@@ -1585,17 +4425,45 @@ void VA_RegisterTransportSend(VA_TransportSendFn sendFn)
 }
 #endif
 
+#if VA_TRANSPORT_IS_UART_DMA
+void VA_RegisterUartDmaStart(VA_UartDmaStartFn startFn)
+{
+    s_va_uart_start = startFn;
+}
+#endif
+
+#if VA_TRANSPORT_IS_LWIP_UDP
+void VA_RegisterLwipUdp(struct udp_pcb *pcb)
+{
+    s_va_lwip_pcb = pcb;
+#if VA_REMOTE_CONTROL
+    if (pcb != NULL)
+        udp_recv(pcb, _va_lwip_recv, NULL);
+#endif
+}
+#endif
+
 void VA_Init(uint32_t cpu_freq)
 {
     VA_CS_ENTER();
     _va_cpu_freq = cpu_freq;
-    g_dwt_overflow_count = 0;
-    g_dwt_last_value = 0;
+    for (int i = 0; i < VA_NUM_CORES; ++i)
+    {
+        g_dwt_epoch[i] = 0;
+    }
+
+#if VA_COMPACT_TIMESTAMPS
+    _va_last_ts = 0;
+    _va_ts_resync = false;
+#endif
 
 #if VA_AUTO_SETUP_INTERVAL_MS > 0
     _va_last_bundle_ts = 0;
-    _va_emitting_bundle = false;
 #endif
+    _va_emitting_bundle = false;
+    _va_bundle_active = false;
+    _va_bundle_cursor = 0;
+    _va_bundle_generation = 0;
 
 #if VA_HAS_RTOS
     for (int i = 0; i < VA_MAX_TASKS; ++i)
@@ -1607,6 +4475,7 @@ void VA_Init(uint32_t cpu_freq)
     }
     next_task_id = 1;
     notificationValue = 0;
+    memset(taskHash, 0, sizeof(taskHash));
 
     for (int i = 0; i < VA_MAX_SYNC_OBJECTS; ++i)
     {
@@ -1615,6 +4484,7 @@ void VA_Init(uint32_t cpu_freq)
         queueObjectMap[i].id = 0;
     }
     next_queue_object_id = 1;
+    memset(queueObjectHash, 0, sizeof(queueObjectHash));
 #endif
 
     for (int i = 0; i < VA_MAX_USER_EVENTS; ++i)
@@ -1623,6 +4493,10 @@ void VA_Init(uint32_t cpu_freq)
         userEventMap[i].id = 0;
         userEventMap[i].name[0] = '\0';
     }
+#if VA_TRACE_USER_STRINGS
+    next_log_format = 0;
+    memset(logFormatHash, 0, sizeof(logFormatHash));
+#endif
 
     _va_enable_dwt_counter();
 
@@ -1635,7 +4509,11 @@ void VA_Init(uint32_t cpu_freq)
     ITM->LAR = 0xC5ACCE55;
 #endif
     ITM->TCR |= ITM_TCR_ITMENA_Msk;
+#if VA_ROUTE_BY_CLASS
+    ITM->TER |= _va_route_mask();
+#else
     ITM->TER |= (1UL << VA_ITM_PORT);
+#endif
 #elif VA_TRANSPORT_IS_JLINK
 #if (VA_CONFIGURE_RTT == 1)
         SEGGER_RTT_Init();
@@ -1644,10 +4522,44 @@ void VA_Init(uint32_t cpu_freq)
     #else
         SEGGER_RTT_ConfigUpBuffer(VA_RTT_CHANNEL, "ViewAlyzer", NULL, 0, VA_RTT_MODE);
     #endif // VA_RTT_BUFFER_SIZE > 0
+    #if VA_REMOTE_CONTROL && (VA_RTT_DOWN_BUFFER_SIZE > 0)
+        SEGGER_RTT_ConfigDownBuffer(VA_RTT_CHANNEL, "ViewAlyzer", s_va_rtt_down_buffer, sizeof(s_va_rtt_down_buffer), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+    #endif
+    #if VA_ROUTE_BY_CLASS && (VA_RTT_ROUTE_BUFFERS > 0)
+    {
+        /* The other routed channels, lowest first; any beyond the pool
+           must be configured by the application. */
+        uint32_t todo = _va_route_mask() & ~(1UL << VA_RTT_CHANNEL);
+        for (uint32_t ch = 0, used = 0; todo != 0u && used < VA_RTT_ROUTE_BUFFERS; ++ch)
+        {
+            if ((todo & (1UL << ch)) == 0u)
+                continue;
+            todo &= ~(1UL << ch);
+            SEGGER_RTT_ConfigUpBuffer(ch, "ViewAlyzer", s_va_rtt_route_buffers[used++], VA_RTT_ROUTE_BUFFER_SIZE, VA_RTT_ROUTE_MODE);
+        }
+    }
+    #endif
 #endif // VA_CONFIGURE_RTT
 #elif VA_TRANSPORT_IS_CUSTOM
     // Nothing to init — user provides send function via VA_RegisterTransportSend()
+#elif VA_TRANSPORT_IS_UART_DMA
+    // Drop what a previous session queued; a transfer still in flight ends
+    // with VA_UartDmaTxComplete() as usual
+    s_va_uart.fill = 0;
+    s_va_uart.dropped = 0;
+#elif VA_TRANSPORT_IS_LWIP_UDP
+    // The open datagram, if any, is sent by the next VA_Drain()
+    s_va_lwip.dropped = 0;
 #endif // VA_TRANSPORT
+#if VA_USE_RING_BUFFER
+    _va_ring_reset();
+#endif
+#if VA_FLIGHT_RECORDER
+    _va_fr_reset();
+#endif
+#if VA_COMPRESS
+    _va_lz_reset();
+#endif
     VA_IS_INIT = true;
 
     _va_emit_packet(VA_SYNC_MARKER, sizeof(VA_SYNC_MARKER));
@@ -1661,6 +4573,14 @@ void VA_Init(uint32_t cpu_freq)
     char info_buf[40];
     _va_u32_to_str(info_buf, sizeof(info_buf), "CLK:", _va_cpu_freq);
     _va_send_setup_packet(VA_SETUP_INFO, 0, info_buf);
+#if VA_COMPACT_TIMESTAMPS
+    _va_send_setup_packet(VA_SETUP_CONFIG_FLAGS, 0, "TS_DELTA");
+    _va_send_time_anchor(_va_get_timestamp());
+#endif
+#if VA_NUM_CORES > 1
+    _va_u32_to_str(info_buf, sizeof(info_buf), "CORES:", VA_NUM_CORES);
+    _va_send_setup_packet(VA_SETUP_CONFIG_FLAGS, 0, info_buf);
+#endif
     _va_send_setup_packet(VA_SETUP_ISR_MAP, VA_ISR_ID_SYSTICK, "SysTick");
 #if (LOG_PENDSV == 1)
     _va_send_setup_packet(VA_SETUP_ISR_MAP, VA_ISR_ID_PENDSV, "PendSV");
@@ -22,6 +22,7 @@
 #include "main.h"
 #include "stdint.h"
 #include "stdbool.h"
+#include "stdarg.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -71,6 +72,8 @@ extern "C"
 #define ARM_ITM            1u
 #define JLINK_RTT          2u
 #define CUSTOM_TRANSPORT   3u
+#define UART_DMA_TRANSPORT 4u
+#define LWIP_UDP_TRANSPORT 5u
 
 #ifndef VA_TRANSPORT
 #define VA_TRANSPORT ARM_ITM  // Select active transport backend
@@ -78,9 +81,34 @@ extern "C"
 #define LOG_PENDSV 0             // Experimental, unused
 
 #define VA_ITM_PORT    1         // ITM stimulus port where logs are sent when using ST-LINK transport
+// Non-blocking ITM: a packet is dropped (and counted) instead of waiting
+// when the stimulus port is busy, and a VA_EVENT_LOSS packet reports the
+// gap once the port drains. A started packet waits at most
+// VA_ITM_SPIN_LIMIT polls per word before it is abandoned.
+#ifndef VA_ITM_NONBLOCKING
+#define VA_ITM_NONBLOCKING 0
+#endif
+#ifndef VA_ITM_SPIN_LIMIT
+#define VA_ITM_SPIN_LIMIT 1000u
+#endif
 #ifndef VA_RTT_CHANNEL
 #define VA_RTT_CHANNEL 0        // RTT channel when using J-LINK RTT transport
 #endif
+// UART DMA transport: COBS frames are queued in one half of a double buffer
+// while the DMA engine sends the other; VA_UartDmaTxComplete() swaps them,
+// so one transfer carries every packet queued during the previous one.
+#ifndef VA_UART_DMA_BUFFER_SIZE
+#define VA_UART_DMA_BUFFER_SIZE 1024u   // Bytes per half
+#endif
+#ifndef VA_UART_DMA_BUFFER_ATTR
+#define VA_UART_DMA_BUFFER_ATTR          // e.g. __attribute__((section(".dma_ram"), aligned(32)))
+#endif
+// lwIP UDP transport: VA_Drain() COBS-encodes packets straight into a pbuf
+// and sends it as one datagram when the next frame would not fit. Keep it
+// under the path MTU minus 28 bytes of IP/UDP headers.
+#ifndef VA_LWIP_DATAGRAM_BYTES
+#define VA_LWIP_DATAGRAM_BYTES 1400u
+#endif
 
 #ifndef VA_MAX_TASKS
 #define VA_MAX_TASKS          16  // RTOS task/thread slots (each ~40 bytes)
@@ -114,14 +142,193 @@ extern "C"
 #define VA_MAX_LOG_STRING_LEN 100  // Max bytes per VA_LogString() message. Protocol max is 1024.
 #endif
 
+#ifndef VA_MAX_TRACE_BLOCK_BYTES
+#define VA_MAX_TRACE_BLOCK_BYTES 128 // Sample bytes per VA_LogTraceBlock() packet; longer blocks are split
+#endif
+
+#ifndef VA_MAX_LOG_FORMATS
+#define VA_MAX_LOG_FORMATS 32      // Distinct VA_Logf() format strings (interned once, formatted on the host)
+#endif
+
 #ifndef VA_CAPTURE_STACK_USAGE
 #define VA_CAPTURE_STACK_USAGE 1 // Set to 0 to disable stack usage packets and queries
 #endif
 
+// Change-only stack sampling: the watermark is refined incrementally at
+// switch-out (at most VA_STACK_SCAN_BUDGET_WORDS stack words per switch) and a
+// stack usage packet is only sent when it moves.  0 = full scan on every switch.
+#ifndef VA_STACK_CHANGE_ONLY
+#define VA_STACK_CHANGE_ONLY 0
+#endif
+#ifndef VA_STACK_SCAN_BUDGET_WORDS
+#define VA_STACK_SCAN_BUDGET_WORDS 32    // Upper bound on stack words read per context switch
+#endif
+
 #ifndef VA_AUTO_SETUP_INTERVAL_MS
 #define VA_AUTO_SETUP_INTERVAL_MS 2000   // Auto re-emit sync + setup packets at this interval (ms). 0 = disabled.
 #endif
 
+#ifndef VA_SETUP_BUNDLE_CHUNK
+#define VA_SETUP_BUNDLE_CHUNK 0          // Map entries per step of an incremental setup bundle. 0 = whole bundle at once
+#endif
+
+// Deferred drain: when enabled, hooks only copy packets into a RAM ring buffer
+// and VA_Drain() (idle hook, low-priority task or timer) feeds the transport.
+#ifndef VA_USE_RING_BUFFER
+#define VA_USE_RING_BUFFER 0             // Set to 1 to take transport latency out of the hooks
+#endif
+#ifndef VA_RING_BUFFER_SIZE
+#define VA_RING_BUFFER_SIZE 4096u        // Ring size in bytes, must be a power of two
+#endif
+
+// Flight recorder (needs VA_USE_RING_BUFFER): packets are kept in the ring,
+// oldest evicted, and nothing is sent until a trigger fires (VA_Trigger(),
+// VA_SetTriggerEvent/Span/OnContention). VA_Drain() then ships the pre- and
+// post-trigger windows and the recorder re-arms.
+#ifndef VA_FLIGHT_RECORDER
+#define VA_FLIGHT_RECORDER 0
+#endif
+#ifndef VA_FLIGHT_PRE_TRIGGER_BYTES
+#define VA_FLIGHT_PRE_TRIGGER_BYTES  ((VA_RING_BUFFER_SIZE) / 2u)   // History kept before the trigger
+#endif
+#ifndef VA_FLIGHT_POST_TRIGGER_BYTES
+#define VA_FLIGHT_POST_TRIGGER_BYTES ((VA_RING_BUFFER_SIZE) / 4u)   // Recorded after the trigger
+#endif
+
+// Priority shedding (needs VA_USE_RING_BUFFER, not with VA_FLIGHT_RECORDER):
+// each event class may fill the ring only up to its level, in percent, so
+// under backpressure user traces and logs are dropped first, then sync
+// objects, and the scheduling timeline survives longest. What was shed is
+// reported to the host with VA_EVENT_LOSS and by VA_GetLostEvents().
+#ifndef VA_PRIORITY_SHEDDING
+#define VA_PRIORITY_SHEDDING 0
+#endif
+#ifndef VA_SHED_LEVEL_TASK
+#define VA_SHED_LEVEL_TASK   100         // Task create / switch / notify, stack usage
+#endif
+#ifndef VA_SHED_LEVEL_ISR
+#define VA_SHED_LEVEL_ISR    100         // ISR enter / exit
+#endif
+#ifndef VA_SHED_LEVEL_SYNC
+#define VA_SHED_LEVEL_SYNC   90          // Queues, semaphores, mutexes, notifications
+#endif
+#ifndef VA_SHED_LEVEL_USER
+#define VA_SHED_LEVEL_USER   75          // User traces, events and toggles
+#endif
+#ifndef VA_SHED_LEVEL_LOG
+#define VA_SHED_LEVEL_LOG    75          // Strings and formatted logs
+#endif
+#ifndef VA_SHED_LEVEL_SYSTEM
+#define VA_SHED_LEVEL_SYSTEM 100         // Setup packets, heap, sleep, loss reports
+#endif
+
+// Compact timestamps: events carry a varint delta from the previous event
+// instead of the full 8-byte cycle count; absolute time is re-anchored by a
+// VA_SETUP_TIME_ANCHOR packet at init and in every setup bundle.
+#ifndef VA_COMPACT_TIMESTAMPS
+#define VA_COMPACT_TIMESTAMPS 0          // Set to 1 to roughly halve the size of most event packets
+#endif
+
+// Multi-core (SMP): every core records into its own ring with its own
+// cycle-counter epoch, and task-switch / ISR packets carry the core id.
+// Needs VA_USE_RING_BUFFER and va_adapter_get_core_id(); call VA_InitCore()
+// on each core other than the one that runs VA_Init().
+#ifndef VA_NUM_CORES
+#define VA_NUM_CORES 1
+#endif
+
+// Inline fast path: ISR enter/exit, task-switch and user event start/end
+// packets are packed into words and stored straight into the ring, ITM port
+// or RTT buffer (see VA_FastPath.h). Not with VA_FLIGHT_RECORDER,
+// VA_COMPACT_TIMESTAMPS or VA_ITM_NONBLOCKING; CUSTOM_TRANSPORT needs
+// VA_USE_RING_BUFFER.
+#ifndef VA_INLINE_FAST_PATH
+#define VA_INLINE_FAST_PATH 0
+#endif
+
+// Remote control: the host can start and stop recording, request a setup
+// bundle and enable or disable event classes or single ids over a down-
+// channel — the RTT down-buffer (VA_PollCommands()) or any byte stream fed
+// to VA_ReceiveCommandBytes(). Disabled events are skipped before their
+// packet is built, with one bitmap lookup.
+#ifndef VA_REMOTE_CONTROL
+#define VA_REMOTE_CONTROL 0
+#endif
+#ifndef VA_RTT_DOWN_BUFFER_SIZE
+#define VA_RTT_DOWN_BUFFER_SIZE 32u      // Bytes reserved for the RTT down-buffer (VA_CONFIGURE_RTT)
+#endif
+
+// Stream compression (CUSTOM, UART_DMA or LWIP_UDP transport, with VA_USE_RING_BUFFER): VA_Drain()
+// packs the packets it sends into LZSS-compressed VA_FRAME_COMPRESSED frames
+// that share a 2^VA_COMPRESS_WINDOW_BITS-byte history, then COBS-frames
+// those. Costs the window plus 1 KB of match table and two frame buffers.
+// Host decoders: python/viewalyzer/lz.py and c/viewalyzer_lz_decoder.hpp.
+#ifndef VA_COMPRESS
+#define VA_COMPRESS 0
+#endif
+#ifndef VA_COMPRESS_WINDOW_BITS
+#define VA_COMPRESS_WINDOW_BITS 11u      // 2 KB history (8..14)
+#endif
+#ifndef VA_COMPRESS_FRAME_BYTES
+#define VA_COMPRESS_FRAME_BYTES 256u     // Compressed bytes per frame, before COBS
+#endif
+#ifndef VA_COMPRESS_RESYNC_BYTES
+#define VA_COMPRESS_RESYNC_BYTES 8192u   // History restarts after this much input, bounding what a lost frame costs
+#endif
+
+// Extra sinks (with VA_USE_RING_BUFFER): VA_Drain() also hands every packet
+// it sends to the sinks added at runtime with VA_AddSink(), e.g. a RAM buffer
+// for post-mortem capture next to the live transport. Each sink has its own
+// class mask and byte budget. Packets are passed by reference, not copied.
+// Not with VA_FLIGHT_RECORDER or VA_COMPACT_TIMESTAMPS.
+#ifndef VA_SINKS
+#define VA_SINKS 0
+#endif
+#ifndef VA_MAX_SINKS
+#define VA_MAX_SINKS 2u
+#endif
+
+// Compile-time event classes: set one to 0 and its hooks and API calls expand
+// to ((void)0) and its code is left out of the image. Task switch, task
+// create and ISR events are always traced. The FreeRTOS hook headers read
+// these too, so define them in the build system rather than only here.
+#ifndef VA_TRACE_QUEUES
+#define VA_TRACE_QUEUES 1        // queue, semaphore, mutex and timer give/take, mutex contention
+#endif
+#ifndef VA_TRACE_NOTIFY
+#define VA_TRACE_NOTIFY 1        // task notifications
+#endif
+#ifndef VA_TRACE_HEAP
+#define VA_TRACE_HEAP 1          // va_logHeapAlloc/Free, VA_LogHeap
+#endif
+#ifndef VA_TRACE_SLEEP
+#define VA_TRACE_SLEEP 1         // sleep enter/exit
+#endif
+#ifndef VA_TRACE_PM
+#define VA_TRACE_PM 1            // power management suspend/resume
+#endif
+#ifndef VA_TRACE_USER_TRACES
+#define VA_TRACE_USER_TRACES 1   // VA_LogTrace*, VA_LogToggle, VA_LogGPIO, VA_LogCounter
+#endif
+#ifndef VA_TRACE_USER_EVENTS
+#define VA_TRACE_USER_EVENTS 1   // VA_LogEvent, VA_EVENT_START/END, VA_FUNCTION_ENTRY/EXIT
+#endif
+#ifndef VA_TRACE_USER_STRINGS
+#define VA_TRACE_USER_STRINGS 1  // VA_LogString, VA_Logf
+#endif
+
+// Value-trace filters: VA_RegisterUserTraceEx() gives a trace id a deadband,
+// a minimum sample interval and/or 1-in-N decimation, so VA_LogTrace,
+// VA_LogTraceFloat and VA_LogCounter only send samples that change the
+// waveform. The last sample held back by the deadband is sent just before
+// the next change.
+#ifndef VA_TRACE_FILTERS
+#define VA_TRACE_FILTERS 0
+#endif
+#ifndef VA_MAX_TRACE_FILTERS
+#define VA_MAX_TRACE_FILTERS 8   // Trace ids that can have a filter
+#endif
+
 // If using J-LINK RTT transport, configure RTT here by setting VA_CONFIGURE_RTT to 1
 // otherwise set to 0 to skip RTT configuration and user is expected to do it elsewhere
 #ifndef VA_CONFIGURE_RTT
@@ -133,6 +340,13 @@ extern "C"
 #ifndef VA_RTT_MODE
 #define VA_RTT_MODE SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL // RTT buffering mode
 #endif
+// Zero-copy RTT: write packets straight into the recorder's up-buffer and
+// publish WrOff once, without SEGGER_RTT_Write() or its lock. Needs
+// VA_CONFIGURE_RTT=1 and VA_RTT_BUFFER_SIZE > 0, and the channel must be
+// ViewAlyzer's alone. NO_BLOCK_TRIM behaves like NO_BLOCK_SKIP.
+#ifndef VA_RTT_ZERO_COPY
+#define VA_RTT_ZERO_COPY 0
+#endif
 
 // Convenience Macros for User Event Timing
 #if (VA_ENABLED == 1)
@@ -160,14 +374,79 @@ extern "C"
 #define VA_TRANSPORT_IS_ITM      ((VA_TRANSPORT) == ARM_ITM)
 #define VA_TRANSPORT_IS_JLINK    ((VA_TRANSPORT) == JLINK_RTT)
 #define VA_TRANSPORT_IS_CUSTOM   ((VA_TRANSPORT) == CUSTOM_TRANSPORT)
+#define VA_TRANSPORT_IS_UART_DMA ((VA_TRANSPORT) == UART_DMA_TRANSPORT)
+#define VA_TRANSPORT_IS_LWIP_UDP ((VA_TRANSPORT) == LWIP_UDP_TRANSPORT)
+// Byte-stream transports: every packet is COBS-framed
+#define VA_TRANSPORT_IS_FRAMED   (VA_TRANSPORT_IS_CUSTOM || VA_TRANSPORT_IS_UART_DMA || VA_TRANSPORT_IS_LWIP_UDP)
+
+// Per-class routing (ARM_ITM, JLINK_RTT): each event class goes to its own
+// ITM stimulus port or RTT channel, so a burst of strings or a setup bundle
+// does not sit in front of scheduling events, and the debugger can turn a
+// class off by clearing its bit in ITM->TER. The host merges the streams by
+// timestamp. Classes left unset stay on VA_ITM_PORT / VA_RTT_CHANNEL.
+#ifndef VA_ROUTE_BY_CLASS
+#define VA_ROUTE_BY_CLASS 0
+#endif
+#if VA_TRANSPORT_IS_JLINK
+#define VA_ROUTE_MAIN VA_RTT_CHANNEL
+#else
+#define VA_ROUTE_MAIN VA_ITM_PORT
+#endif
+#ifndef VA_ROUTE_TASK
+#define VA_ROUTE_TASK   VA_ROUTE_MAIN    // task switch, create, notify, stack usage
+#endif
+#ifndef VA_ROUTE_ISR
+#define VA_ROUTE_ISR    VA_ROUTE_MAIN
+#endif
+#ifndef VA_ROUTE_SYNC
+#define VA_ROUTE_SYNC   VA_ROUTE_MAIN    // semaphores, mutexes, queues, timers
+#endif
+#ifndef VA_ROUTE_USER
+#define VA_ROUTE_USER   VA_ROUTE_MAIN    // user traces, toggles, events, sample blocks
+#endif
+#ifndef VA_ROUTE_LOG
+#define VA_ROUTE_LOG    VA_ROUTE_MAIN    // VA_LogString, VA_Logf
+#endif
+#ifndef VA_ROUTE_SYSTEM
+#define VA_ROUTE_SYSTEM VA_ROUTE_MAIN    // setup bundle, heap, sleep, PM, loss reports
+#endif
+// RTT channels other than VA_RTT_CHANNEL (VA_CONFIGURE_RTT=1): buffers the
+// recorder configures for them (lowest channel first), and their mode.
+#ifndef VA_RTT_ROUTE_BUFFERS
+#define VA_RTT_ROUTE_BUFFERS 2u
+#endif
+#ifndef VA_RTT_ROUTE_BUFFER_SIZE
+#define VA_RTT_ROUTE_BUFFER_SIZE 1024u
+#endif
+#ifndef VA_RTT_ROUTE_MODE
+#define VA_RTT_ROUTE_MODE SEGGER_RTT_MODE_NO_BLOCK_SKIP
+#endif
+
+// Bytes an event timestamp can take on the wire (LEB128 of a 64-bit delta
+// needs up to 10).
+#if VA_COMPACT_TIMESTAMPS
+#define VA_TS_MAX_BYTES 10
+#else
+#define VA_TS_MAX_BYTES 8
+#endif
 
 // Maximum raw packet size (before COBS encoding).
-// Largest packet is VA_LogString: 12-byte header + message payload.
-#define VA_MAX_PACKET_SIZE (12 + VA_MAX_LOG_STRING_LEN)
+// Largest packet is VA_LogString (type + id + timestamp + 2-byte length + message)
+// or VA_LogTraceBlock (type + id + timestamp + 7-byte block header + samples).
+#if (VA_MAX_TRACE_BLOCK_BYTES) + 5 > (VA_MAX_LOG_STRING_LEN)
+#define VA_MAX_PACKET_SIZE (9 + VA_TS_MAX_BYTES + VA_MAX_TRACE_BLOCK_BYTES)
+#else
+#define VA_MAX_PACKET_SIZE (4 + VA_TS_MAX_BYTES + VA_MAX_LOG_STRING_LEN)
+#endif
 
 // User-provided send function signature for custom transport
 typedef void (*VA_TransportSendFn)(const uint8_t *data, uint32_t length);
 
+// Starts a DMA transfer of `length` bytes and returns without waiting; the
+// DMA-complete interrupt then calls VA_UartDmaTxComplete(). `data` stays
+// valid until then.
+typedef void (*VA_UartDmaStartFn)(const uint8_t *data, uint32_t length);
+
 // --- Binary Event Type Codes ---
 #define VA_EVENT_TYPE_MASK        0x7F
 #define VA_EVENT_FLAG_START_END   0x80
@@ -193,9 +472,14 @@ typedef void (*VA_TransportSendFn)(const uint8_t *data, uint32_t length);
 #define VA_EVENT_TIMER            0x13
 #define VA_EVENT_HEAP_SYNC        0x14
 #define VA_EVENT_PM_SUSPEND       0x15
+#define VA_EVENT_LOG_FORMAT       0x16  // [fmt id][args len][packed args] — see VA_Logf()
+#define VA_EVENT_TRACE_BLOCK      0x17  // [sample type][count 2B LE][period 4B LE][samples] — see VA_LogTraceBlock()
+#define VA_EVENT_LOSS             0x18  // [0x18][0][first loss 8B LE][events 4B][bytes 4B][n][n x events per class 2B] — see VA_ITM_NONBLOCKING
+#define VA_FRAME_COMPRESSED       0x19  // [0x19][reset<<7 | seq][params, reset frames only][LZSS bits] — several packets, see VA_COMPRESS
 
 
 // --- Setup Message Codes ---
+#define VA_SETUP_LOG_FORMAT        0x6F  // [0x6F][fmt id][len 2B LE][format string] — VA_Logf() format table
 #define VA_SETUP_TASK_MAP          0x70
 #define VA_SETUP_ISR_MAP           0x71
 #define VA_SETUP_INFO              0x7F
@@ -212,6 +496,15 @@ typedef void (*VA_TransportSendFn)(const uint8_t *data, uint32_t length);
 #define VA_SETUP_TIMER_MAP         0x7B
 #define VA_SETUP_HEAP_MAP          0x7C
 #define VA_SETUP_PM_MAP            0x7D
+#define VA_SETUP_TIME_ANCHOR       0x7E  // [0x7E][0][timestamp 8B LE] — resets the delta base (VA_COMPACT_TIMESTAMPS)
+
+// Host-to-target commands (VA_REMOTE_CONTROL), each one COBS frame ending in 0x00
+#define VA_CMD_START        0x01  // [0x01]                 resume recording
+#define VA_CMD_STOP         0x02  // [0x02]                 stop recording events (setup packets still go out)
+#define VA_CMD_SETUP_BUNDLE 0x03  // [0x03]                 send a setup bundle
+#define VA_CMD_SET_CLASSES  0x04  // [0x04][mask]           bit n enables VA_TraceClass_t n
+#define VA_CMD_SET_ID       0x05  // [0x05][class][id][on]  enable or disable one id of a class
+#define VA_CMD_SET_ALL_IDS  0x06  // [0x06][class][on]      enable or disable every id of a class
 
     typedef enum
     {
@@ -226,6 +519,64 @@ typedef void (*VA_TransportSendFn)(const uint8_t *data, uint32_t length);
         VA_USER_TYPE_ISR       = 8
     } VA_UserTraceType_t;
 
+    // Event classes, for loss accounting
+    typedef enum
+    {
+        VA_CLASS_TASK   = 0,  // task switch, create, notify, stack usage
+        VA_CLASS_ISR    = 1,
+        VA_CLASS_SYNC   = 2,  // semaphores, mutexes, queues, timers, contention
+        VA_CLASS_USER   = 3,  // user traces, toggles, events, GPIO, counters, sample blocks
+        VA_CLASS_LOG    = 4,  // VA_LogString, VA_Logf
+        VA_CLASS_SYSTEM = 5,  // heap, sleep, power management, setup and sync packets
+        VA_CLASS_COUNT
+    } VA_TraceClass_t;
+
+#define VA_CLASS_BIT(cls)   (1u << (cls))
+#define VA_ALL_CLASSES      ((1u << VA_CLASS_COUNT) - 1u)
+
+    // Extra sink (VA_SINKS). `packet` is one unframed packet, valid only
+    // during the call; the sink frames or copies it as it needs.
+    typedef void (*VA_SinkFn)(void *ctx, const uint8_t *packet, uint32_t length);
+
+    typedef struct
+    {
+        VA_SinkFn fn;
+        void     *ctx;
+        uint32_t  classMask;      // VA_CLASS_BIT(cls) of the classes it gets, or VA_ALL_CLASSES
+        uint32_t  bytesPerSecond; // budget refill rate; 0 = no budget
+        uint32_t  burstBytes;     // budget depth; 0 = one second's worth
+    } VA_Sink_t;
+
+    // Post-mortem RAM sink: VA_RamSinkWrite() keeps the newest COBS frames in
+    // buf, overwriting the oldest. Dumped oldest first (VA_RamSinkRead(), or
+    // buf rotated at head), it is a capture any host decoder reads.
+    typedef struct
+    {
+        uint8_t *buf;
+        uint32_t size;
+        uint32_t head;    // next write offset
+        bool     wrapped; // buf holds size bytes of stream
+    } VA_RamSink_t;
+
+    typedef enum
+    {
+        VA_SAMPLE_INT16   = 0,
+        VA_SAMPLE_INT32   = 1,
+        VA_SAMPLE_FLOAT32 = 2
+    } VA_SampleType_t;
+
+    // Filter of one value trace (VA_RegisterUserTraceEx). A sample within the
+    // deadband of the last one sent is held back; with both bands 0 only
+    // repeated values are. A changed sample is then sent if minIntervalCycles
+    // have passed since the last one sent, and only every decimate-th time.
+    typedef struct
+    {
+        float    deadband;          // absolute band, in trace units
+        float    deadbandPct;       // relative band, percent of the last value sent
+        uint32_t minIntervalCycles; // 0 = no minimum
+        uint16_t decimate;          // 0 or 1 = send every changed sample
+    } VA_TraceFilter_t;
+
     typedef enum
     {
         TOGGLE_LOW,
@@ -260,32 +611,132 @@ typedef void (*VA_TransportSendFn)(const uint8_t *data, uint32_t length);
     // user API
 #if VA_TRANSPORT_IS_CUSTOM
     void VA_RegisterTransportSend(VA_TransportSendFn sendFn);
+#endif
+#if VA_TRANSPORT_IS_UART_DMA
+    void VA_RegisterUartDmaStart(VA_UartDmaStartFn startFn);
+    void VA_UartDmaTxComplete(void); // call from the UART TX DMA-complete interrupt
+#endif
+#if VA_TRANSPORT_IS_LWIP_UDP
+    struct udp_pcb;
+    void VA_RegisterLwipUdp(struct udp_pcb *pcb); // connected pcb; call from lwIP context
 #endif
     void VA_Init(uint32_t cpu_freq);
     void VA_EmitSetupBundle(void);    // re-emit sync marker + all setup packets (call periodically, e.g. every 2-5 s)
-    void VA_TickOverflowCheck(void);  // call periodically (e.g. every 1-10 s) to prevent DWT rollover misses
+    void VA_RequestSetupBundle(void); // start a setup bundle, spread over VA_SETUP_BUNDLE_CHUNK-entry steps (immediate if 0)
+    void VA_TickOverflowCheck(void);  // call at least every 2^31 CPU cycles (~4 s at 480 MHz) to prevent DWT rollover misses
+    uint32_t VA_Drain(uint32_t maxBytes); // push buffered packets to the transport (VA_USE_RING_BUFFER); 0 = no limit. Returns bytes sent
+    uint32_t VA_GetDroppedCount(void);    // packets dropped because the ring buffer, non-blocking ITM port or UART DMA buffer was full
+    uint32_t VA_GetLostEvents(VA_TraceClass_t cls); // packets of a class dropped by the non-blocking ITM port or priority shedding
+    uint32_t VA_GetLostBytes(VA_TraceClass_t cls);  // bytes of those packets
+#if VA_FLIGHT_RECORDER
+    void VA_Trigger(void);                                               // freeze the flight recorder window now
+    void VA_SetTriggerEvent(uint8_t type, uint8_t id);                   // trigger on an event packet (type 0 = off)
+    void VA_SetTriggerSpan(uint8_t type, uint8_t id, uint32_t maxCycles); // trigger when a start..end span exceeds maxCycles (0 = off)
+    void VA_SetTriggerOnContention(bool enable);                         // trigger on any mutex contention packet
+#else
+#define VA_Trigger() ((void)0)
+#define VA_SetTriggerEvent(type, id) ((void)0)
+#define VA_SetTriggerSpan(type, id, maxCycles) ((void)0)
+#define VA_SetTriggerOnContention(enable) ((void)0)
+#endif
+#if VA_SINKS
+    int  VA_AddSink(const VA_Sink_t *sink);              // returns a handle, or -1 if VA_MAX_SINKS are in use
+    void VA_RemoveSink(int handle);                      // must not race VA_Drain(): a running drain may still call the sink
+    void VA_SetSinkClasses(int handle, uint32_t classMask);
+    uint32_t VA_GetSinkDropped(int handle);               // packets the sink's budget turned away
+    void VA_RamSinkInit(VA_RamSink_t *ram, void *buf, uint32_t size);
+    void VA_RamSinkWrite(void *ram, const uint8_t *packet, uint32_t length); // a VA_SinkFn, ctx = VA_RamSink_t *
+    uint32_t VA_RamSinkRead(const VA_RamSink_t *ram, uint8_t *dst, uint32_t max); // oldest first; returns bytes copied
+#else
+#define VA_AddSink(sink) (-1)
+#define VA_RemoveSink(handle) ((void)0)
+#define VA_SetSinkClasses(handle, classMask) ((void)0)
+#define VA_GetSinkDropped(handle) (0u)
+#endif
+#if VA_NUM_CORES > 1
+    void VA_InitCore(void);           // start this core's cycle counter; call on every core except the VA_Init() one
+#else
+#define VA_InitCore() ((void)0)
+#endif
+#if VA_REMOTE_CONTROL
+    void VA_ReceiveCommandBytes(const uint8_t *data, uint32_t length); // feed down-channel bytes; runs each complete command
+    void VA_PollCommands(void);                                        // read commands from the RTT down-buffer (JLINK_RTT)
+    void VA_SetRecording(bool on);                                     // same as VA_CMD_START / VA_CMD_STOP
+    void VA_SetClassEnabled(VA_TraceClass_t cls, bool on);
+    void VA_SetIdEnabled(VA_TraceClass_t cls, uint8_t id, bool on);    // id = task, ISR, object, trace or message id
+#else
+#define VA_ReceiveCommandBytes(data, length) ((void)0)
+#define VA_PollCommands() ((void)0)
+#define VA_SetRecording(on) ((void)0)
+#define VA_SetClassEnabled(cls, on) ((void)0)
+#define VA_SetIdEnabled(cls, id, on) ((void)0)
+#endif
     void VA_RegisterUserTrace(uint8_t id, const char *name, VA_UserTraceType_t type);
+#if VA_TRACE_FILTERS && VA_TRACE_USER_TRACES
+    void VA_RegisterUserTraceEx(uint8_t id, const char *name, VA_UserTraceType_t type,
+                                const VA_TraceFilter_t *filter); // NULL = remove the filter
+#else
+#define VA_RegisterUserTraceEx(id, name, type, filter) VA_RegisterUserTrace(id, name, type)
+#endif
     void VA_RegisterUserEvent(uint8_t id, const char *name);
     void VA_RegisterUserFunction(uint8_t id, const char *name); /* backward-compatible alias */
     void VA_LogISRStart(uint8_t isrId);
     void VA_LogISREnd(uint8_t isrId);
+#if VA_TRACE_USER_TRACES
     void VA_LogTrace(uint8_t id, int32_t value);
     void VA_LogTraceFloat(uint8_t id, float value);
-    void VA_LogString(uint8_t id, const char *msg);
+    void VA_LogTraceBlock(uint8_t id, VA_SampleType_t type, const void *samples,
+                          uint16_t count, uint32_t samplePeriodCycles); // last sample taken now, earlier ones one period apart
     void VA_LogToggle(uint8_t id, bool state);
-    void VA_LogEvent(uint8_t id, bool state);
-    void VA_LogUserEvent(uint8_t id, bool state); /* backward-compatible alias */
     void VA_LogGPIO(uint8_t id, bool state);
     void VA_LogCounter(uint8_t id, uint32_t value);
+#else
+#define VA_LogTrace(id, value) ((void)0)
+#define VA_LogTraceFloat(id, value) ((void)0)
+#define VA_LogTraceBlock(id, type, samples, count, samplePeriodCycles) ((void)0)
+#define VA_LogToggle(id, state) ((void)0)
+#define VA_LogGPIO(id, state) ((void)0)
+#define VA_LogCounter(id, value) ((void)0)
+#endif
+#if VA_TRACE_USER_STRINGS
+    void VA_LogString(uint8_t id, const char *msg);
+    void VA_Logf(uint8_t id, const char *fmt, ...);          // printf-style, formatted on the host; fmt must be a string literal
+    void VA_VLogf(uint8_t id, const char *fmt, va_list args);
+#else
+#define VA_LogString(id, msg) ((void)0)
+#define VA_Logf(id, ...) ((void)0)
+#define VA_VLogf(id, fmt, args) ((void)0)
+#endif
+#if VA_TRACE_USER_EVENTS
+    void VA_LogEvent(uint8_t id, bool state);
+    void VA_LogUserEvent(uint8_t id, bool state); /* backward-compatible alias */
+#else
+#define VA_LogEvent(id, state) ((void)0)
+#define VA_LogUserEvent(id, state) ((void)0)
+#endif
+#if VA_TRACE_HEAP
     void VA_LogHeap(uint8_t id, uint32_t usedBytes);
+#else
+#define VA_LogHeap(id, usedBytes) ((void)0)
+#endif
 
     /* ── Sleep tracing (Zephyr k_sleep / k_msleep / k_usleep) ── */
+#if VA_TRACE_SLEEP
     void va_logSleepEnter(void *taskHandle);
     void va_logSleepExit(void *taskHandle);
+#else
+#define va_logSleepEnter(h) ((void)0)
+#define va_logSleepExit(h) ((void)0)
+#endif
 
     /* ── PM tracing (Zephyr pm_system_suspend enter/exit) ── */
+#if VA_TRACE_PM
     void va_logPMSuspendEnter(void);
     void va_logPMSuspendExit(uint8_t state);
+#else
+#define va_logPMSuspendEnter() ((void)0)
+#define va_logPMSuspendExit(state) ((void)0)
+#endif
 
     void VA_RegisterGPIO(uint8_t id, const char *name);
     void VA_RegisterHeap(uint8_t id, const char *name, uint32_t totalSize);
@@ -301,20 +752,37 @@ typedef void (*VA_TransportSendFn)(const uint8_t *data, uint32_t length);
     void va_taskcreated(void *taskHandle, const char *name);
     bool va_isnit(void);
     
+#if VA_TRACE_NOTIFY
     void va_logtasknotifygive(void *srcHandle, void *destHandle, uint32_t value);
     void va_logtasknotifytake(void *taskHandle, uint32_t value);
+#else
+#define va_logtasknotifygive(s, d, v) ((void)0)
+#define va_logtasknotifytake(h, v) ((void)0)
+#endif
 
-    // Unified object tracking API
+    // Unified object tracking API (creation still names the objects when
+    // VA_TRACE_QUEUES is 0: heaps and PM share the registry)
     void va_logQueueObjectCreate(void *queueObject, const char *name);
     void va_logQueueObjectCreateWithType(void *queueObject, const char *typeHint);
     void va_updateQueueObjectType(void *queueObject, const char *typeHint);
+#if VA_TRACE_QUEUES
     void va_logQueueObjectGive(void *queueObject, uint32_t timeout);
     void va_logQueueObjectTake(void *queueObject, uint32_t timeout);
     void va_logQueueObjectBlocking(void *queueObject);
+#else
+#define va_logQueueObjectGive(queueObject, timeout) ((void)0)
+#define va_logQueueObjectTake(queueObject, timeout) ((void)0)
+#define va_logQueueObjectBlocking(queueObject) ((void)0)
+#endif
 
     // Heap alloc/free tracing (sends 14-byte data event with allocated_bytes from runtime stats)
+#if VA_TRACE_HEAP
     void va_logHeapAlloc(void *heapObject, uint32_t allocBytes);
     void va_logHeapFree(void *heapObject, uint32_t allocatedBytes);
+#else
+#define va_logHeapAlloc(heapObject, allocBytes) ((void)0)
+#define va_logHeapFree(heapObject, allocatedBytes) ((void)0)
+#endif
 
     extern volatile uint32_t notificationValue;
 
@@ -341,25 +809,76 @@ typedef void (*VA_TransportSendFn)(const uint8_t *data, uint32_t length);
      */
     uint32_t va_adapter_get_total_stack_size(void *taskHandle);
 
+    /** Painted stack of a task, lowest address first (descending stacks). */
+    typedef struct
+    {
+        const uint32_t *base;       /* first (lowest) word of the stack            */
+        uint32_t        words;      /* stack size in 32-bit words                  */
+        uint32_t        fill;       /* word value of never-touched stack           */
+        uint8_t         unit_shift; /* words -> units of va_adapter_get_total_stack_size() */
+    } VA_StackRegion_t;
+
+    /** Describe the painted stack of a task so the core can scan it
+     *  incrementally (VA_STACK_CHANGE_ONLY).  Return false if the stack is
+     *  not painted or its bounds are unknown; the core then falls back to
+     *  va_adapter_calculate_stack_usage().
+     */
+    bool va_adapter_get_stack_region(void *taskHandle, VA_StackRegion_t *region);
+
     /** Detect mutex contention and emit a contention packet if applicable.
      *  Called from va_logQueueObjectBlocking().
      */
     void va_adapter_check_mutex_contention(void *queueObject, uint8_t queue_va_id);
 #endif /* VA_HAS_RTOS */
 
+#if VA_NUM_CORES > 1
+    /** Index (0 .. VA_NUM_CORES-1) of the core executing the caller.
+     *  FreeRTOS: portGET_CORE_ID().  Zephyr: arch_curr_cpu()->id.
+     *  Bare-metal multi-core builds must provide it themselves.
+     */
+    uint32_t va_adapter_get_core_id(void);
+#endif
+
 #else
 // --- Empty stubs ---
 #define VA_RegisterTransportSend(fn) ((void)0)
+#define VA_RegisterUartDmaStart(fn) ((void)0)
+#define VA_UartDmaTxComplete() ((void)0)
+#define VA_RegisterLwipUdp(pcb) ((void)0)
 #define VA_Init(cpu_freq) ((void)0)
+#define VA_EmitSetupBundle() ((void)0)
+#define VA_RequestSetupBundle() ((void)0)
 #define VA_TickOverflowCheck() ((void)0)
+#define VA_Drain(maxBytes) (0u)
+#define VA_GetDroppedCount() (0u)
+#define VA_GetLostEvents(cls) (0u)
+#define VA_GetLostBytes(cls) (0u)
+#define VA_Trigger() ((void)0)
+#define VA_SetTriggerEvent(type, id) ((void)0)
+#define VA_SetTriggerSpan(type, id, maxCycles) ((void)0)
+#define VA_SetTriggerOnContention(enable) ((void)0)
+#define VA_InitCore() ((void)0)
+#define VA_AddSink(sink) (-1)
+#define VA_RemoveSink(handle) ((void)0)
+#define VA_SetSinkClasses(handle, classMask) ((void)0)
+#define VA_GetSinkDropped(handle) (0u)
+#define VA_ReceiveCommandBytes(data, length) ((void)0)
+#define VA_PollCommands() ((void)0)
+#define VA_SetRecording(on) ((void)0)
+#define VA_SetClassEnabled(cls, on) ((void)0)
+#define VA_SetIdEnabled(cls, id, on) ((void)0)
 #define VA_RegisterUserEvent(id, name) ((void)0)
 #define VA_RegisterUserTrace(id, name, type) ((void)0)
+#define VA_RegisterUserTraceEx(id, name, type, filter) ((void)0)
 #define VA_RegisterUserFunction(id, name) ((void)0)
 #define VA_LogISRStart(isrId) ((void)0)
 #define VA_LogISREnd(isrId) ((void)0)
 #define VA_LogTrace(id, value) ((void)0)
 #define VA_LogTraceFloat(id, value) ((void)0)
+#define VA_LogTraceBlock(id, type, samples, count, samplePeriodCycles) ((void)0)
 #define VA_LogString(id, msg) ((void)0)
+#define VA_Logf(id, ...) ((void)0)
+#define VA_VLogf(id, fmt, args) ((void)0)
 #define VA_LogToggle(id, state) ((void)0)
 #define VA_LogEvent(id, state) ((void)0)
 #define VA_LogUserEvent(id, state) ((void)0)
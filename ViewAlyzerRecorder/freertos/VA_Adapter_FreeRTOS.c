@@ -5,7 +5,9 @@
  * Contains everything that depends on FreeRTOS internals:
  *   - Queue-type detection (QueueDefinitionMirror hack)
  *   - Stack-usage calculation via uxTaskGetStackHighWaterMark
+ *   - Painted-stack bounds for incremental watermark sampling
  *   - Mutex-contention detection via xSemaphoreGetMutexHolder
+ *   - Core id for SMP builds (configNUMBER_OF_CORES > 1)
  *
  * This file is compiled ONLY when VA_RTOS_SELECT == VA_RTOS_FREERTOS.
  *
@@ -113,6 +115,28 @@ uint32_t va_adapter_calculate_stack_usage(void *taskHandle)
 #endif
 }
 
+bool va_adapter_get_stack_region(void *taskHandle, VA_StackRegion_t *region)
+{
+#if (portSTACK_GROWTH < 0) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
+    /* With the high-water-mark API enabled, tasks.c paints every new stack
+     * with tskSTACK_FILL_BYTE (0xa5); pxStack is its lowest address. */
+    int idx = _va_find_task_index(taskHandle);
+    if (sizeof(StackType_t) != sizeof(uint32_t) || idx < 0 ||
+        taskMap[idx].pxStack == NULL || taskMap[idx].ulStackDepth == 0)
+        return false;
+
+    region->base = (const uint32_t *)taskMap[idx].pxStack;
+    region->words = taskMap[idx].ulStackDepth;
+    region->fill = 0xa5a5a5a5u;
+    region->unit_shift = 0;
+    return true;
+#else
+    (void)taskHandle;
+    (void)region;
+    return false;
+#endif
+}
+
 uint32_t va_adapter_get_total_stack_size(void *taskHandle)
 {
     int idx = _va_find_task_index(taskHandle);
@@ -158,4 +182,20 @@ void va_adapter_check_mutex_contention(void *queueObject, uint8_t queue_va_id)
 #endif
 }
 
+/* ================================================================
+ *  Multi-core (FreeRTOS SMP)
+ * ================================================================ */
+#if VA_NUM_CORES > 1
+
+#if !defined(configNUMBER_OF_CORES) || (configNUMBER_OF_CORES != VA_NUM_CORES)
+#error "VA_NUM_CORES must match configNUMBER_OF_CORES"
+#endif
+
+uint32_t va_adapter_get_core_id(void)
+{
+    return (uint32_t)portGET_CORE_ID();
+}
+
+#endif
+
 #endif /* VA_ENABLED && VA_RTOS_FREERTOS */
@@ -15,13 +15,17 @@ extern "C" {
 void va_taskswitchedin(void *taskHandle);
 void va_taskswitchedout(void *taskHandle);
 void va_taskcreated(void *taskHandle, const char *name);
+#if !defined(VA_TRACE_NOTIFY) || VA_TRACE_NOTIFY
 void va_logtasknotifygive(void *srcHandle, void *destHandle, uint32_t value);
 void va_logtasknotifytake(void *taskHandle, uint32_t value);
+#endif
+#if !defined(VA_TRACE_QUEUES) || VA_TRACE_QUEUES
 void va_logQueueObjectCreateWithType(void *queueObject, const char *typeHint);
 void va_updateQueueObjectType(void *queueObject, const char *typeHint);
 void va_logQueueObjectGive(void *queueObject, uint32_t timeout);
 void va_logQueueObjectTake(void *queueObject, uint32_t timeout);
 void va_logQueueObjectBlocking(void *queueObject);
+#endif
 
 #ifdef __cplusplus
 }
@@ -63,12 +67,17 @@ extern volatile uint32_t g_task_ulStackDepth;
         va_taskcreated((void *)(pxNewTCB), pcTaskGetName(pxNewTCB));  \
     } while (0)
 
+// VA_TRACE_NOTIFY=0 (build define) leaves FreeRTOS's empty defaults in place
+#if !defined(VA_TRACE_NOTIFY) || VA_TRACE_NOTIFY
 extern volatile uint32_t notificationValue;
 #define traceTASK_NOTIFY() (notificationValue = ulValue, va_logtasknotifygive((void *)pxCurrentTCB, (void *)pxTCB, ulValue))
 #define traceTASK_NOTIFY_FROM_ISR() (notificationValue = ulValue, va_logtasknotifygive(NULL, (void *)pxTCB, ulValue))
 #define traceTASK_NOTIFY_GIVE_FROM_ISR() (notificationValue = pxTCB->ulNotifiedValue, va_logtasknotifygive(NULL, (void *)pxTCB, pxTCB->ulNotifiedValue))
 #define traceTASK_NOTIFY_TAKE() va_logtasknotifytake((void *)pxCurrentTCB, pxCurrentTCB->ulNotifiedValue)
+#endif
 
+// VA_TRACE_QUEUES=0 drops queue, semaphore and mutex tracing, creation included
+#if !defined(VA_TRACE_QUEUES) || VA_TRACE_QUEUES
 // Queue tracing - unified approach using generic queue creation macro
 // FreeRTOS uses queues as the underlying mechanism for mutexes, semaphores, and queues
 // VA uses a single hook that inspects the ucQueueType field to determine object type
@@ -121,6 +130,7 @@ extern volatile uint32_t notificationValue;
 // This is where we can detect contention since the mutex is still held by another task
 #define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
     va_logQueueObjectBlocking((pxQueue))
+#endif
 
 // Semaphore operations - these are also queues but we can add specific tracing
 // Binary semaphores are created through xSemaphoreCreateBinary() which calls xQueueCreateBinary()
@@ -37,13 +37,17 @@ extern "C" {
 void va_taskswitchedin(void *taskHandle);
 void va_taskswitchedout(void *taskHandle);
 void va_taskcreated(void *taskHandle, const char *name);
+#if !defined(VA_TRACE_NOTIFY) || VA_TRACE_NOTIFY
 void va_logtasknotifygive(void *srcHandle, void *destHandle, uint32_t value);
 void va_logtasknotifytake(void *taskHandle, uint32_t value);
+#endif
+#if !defined(VA_TRACE_QUEUES) || VA_TRACE_QUEUES
 void va_logQueueObjectCreateWithType(void *queueObject, const char *typeHint);
 void va_updateQueueObjectType(void *queueObject, const char *typeHint);
 void va_logQueueObjectGive(void *queueObject, uint32_t timeout);
 void va_logQueueObjectTake(void *queueObject, uint32_t timeout);
 void va_logQueueObjectBlocking(void *queueObject);
+#endif
 
 #ifdef __cplusplus
 }
@@ -53,8 +57,15 @@ void va_logQueueObjectBlocking(void *queueObject);
 #define configRECORD_STACK_HIGH_ADDRESS 1
 
 // --- FreeRTOS Trace Macro Definitions ---
+#if defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1)
+// SMP kernels (V11+) keep one current TCB per core; include this header after
+// configNUMBER_OF_CORES is defined so the switch hooks index it directly.
+#define traceTASK_SWITCHED_IN() va_taskswitchedin((void *)pxCurrentTCBs[portGET_CORE_ID()])
+#define traceTASK_SWITCHED_OUT() va_taskswitchedout((void *)pxCurrentTCBs[portGET_CORE_ID()])
+#else
 #define traceTASK_SWITCHED_IN() va_taskswitchedin((void *)pxCurrentTCB)
 #define traceTASK_SWITCHED_OUT() va_taskswitchedout((void *)pxCurrentTCB)
+#endif
 
 // Enhanced task creation macro that captures TCB information
 extern volatile void *g_task_pxStack;
@@ -85,6 +96,8 @@ extern volatile uint32_t g_task_ulStackDepth;
 // Task notification tracing - real FreeRTOS macros
 // Updated for FreeRTOS V10.4.0+ which added uxIndexToNotify/uxIndexToWait parameters
 
+// VA_TRACE_NOTIFY=0 (build define) leaves FreeRTOS's empty defaults in place
+#if !defined(VA_TRACE_NOTIFY) || VA_TRACE_NOTIFY
 extern volatile uint32_t notificationValue;
 #define traceTASK_NOTIFY(uxIndexToNotify) (notificationValue = ulValue, va_logtasknotifygive((void *)pxCurrentTCB, (void *)pxTCB, ulValue))
 #define traceTASK_NOTIFY_FROM_ISR(uxIndexToNotify) (notificationValue = ulValue, va_logtasknotifygive(NULL, (void *)pxTCB, ulValue))
@@ -93,7 +106,10 @@ extern volatile uint32_t notificationValue;
 #define traceTASK_NOTIFY_TAKE_BLOCK(uxIndexToWait) va_logtasknotifytake((void *)pxCurrentTCB, pxCurrentTCB->ulNotifiedValue[(uxIndexToWait)])
 #define traceTASK_NOTIFY_WAIT(uxIndexToWait) va_logtasknotifytake((void *)pxCurrentTCB, pxCurrentTCB->ulNotifiedValue[(uxIndexToWait)])
 #define traceTASK_NOTIFY_WAIT_BLOCK(uxIndexToWait) va_logtasknotifytake((void *)pxCurrentTCB, pxCurrentTCB->ulNotifiedValue[(uxIndexToWait)])
+#endif
 
+// VA_TRACE_QUEUES=0 drops queue, semaphore and mutex tracing, creation included
+#if !defined(VA_TRACE_QUEUES) || VA_TRACE_QUEUES
 // Queue tracing - unified approach using generic queue creation macro
 // FreeRTOS uses queues as the underlying mechanism for mutexes, semaphores, and queues
 // We use a single hook that inspects the ucQueueType field to determine object type
@@ -146,6 +162,7 @@ extern volatile uint32_t notificationValue;
 // This is where we can detect contention since the mutex is still held by another task
 #define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
     va_logQueueObjectBlocking((pxQueue))
+#endif
 
 // Semaphore operations - these are also queues but we can add specific tracing
 // Binary semaphores are created through xSemaphoreCreateBinary() which calls xQueueCreateBinary()
@@ -36,6 +36,7 @@ from viewalyzer.protocol import (
     build_string_event,
 )
 from viewalyzer.cobs import cobs_encode, cobs_decode
+from viewalyzer.lz import LzDecoder
 from viewalyzer.sender import ViewAlyzerSender
 
 __version__ = "0.1.0"
@@ -45,6 +46,8 @@ __all__ = [
     "ViewAlyzerSender",
     # COBS
     "cobs_encode", "cobs_decode",
+    # Compressed recorder frames (VA_COMPRESS)
+    "LzDecoder",
     # Core constants
     "SYNC_MARKER", "FLAG_START", "TraceType",
     "EVT_USER_TRACE", "EVT_FLOAT_TRACE", "EVT_STRING_EVENT",
@@ -0,0 +1,119 @@
+"""
+viewalyzer.lz — decoder for the recorder's compressed frames (VA_COMPRESS).
+
+With ``VA_COMPRESS=1`` the C recorder packs the packets sent by one
+``VA_Drain()`` call into COBS frames of type 0x19::
+
+    [0x19][reset << 7 | seq][params, reset frames only][LZSS bitstream]
+
+``params`` is ``(window_bits - 8) << 4 | length_bits``.  The bitstream is
+read MSB first: ``1`` + 8-bit literal, or ``0`` + (distance - 1) in
+``window_bits`` + (length - 3) in ``length_bits``.  The history carries over
+from frame to frame until the next reset frame.  Decompressed, it is a
+sequence of ``[LEB128 length][packet]`` records.
+
+Feed every COBS-decoded frame to :meth:`LzDecoder.decode_frame`; frames of
+other types pass through unchanged, so mixed captures work too.
+"""
+
+FRAME_COMPRESSED = 0x19
+
+_MIN_MATCH = 3
+
+
+class LzDecoder:
+    """Stateful decoder for one recorder's frame stream."""
+
+    def __init__(self) -> None:
+        self._hist = bytearray()
+        self._window = 0
+        self._len_bits = 0
+        self._next_seq = None   # None: wait for a reset frame
+        self.frames_lost = 0
+
+    def decode_frame(self, frame: bytes) -> list:
+        """Return the packets carried by one COBS-decoded *frame*.
+
+        A frame that does not follow the previous one in sequence can't be
+        decoded: it and every frame up to the next reset frame are skipped
+        and counted in :attr:`frames_lost`.
+        """
+        if len(frame) < 2 or frame[0] != FRAME_COMPRESSED:
+            return [bytes(frame)] if frame else []
+
+        ctl = frame[1]
+        seq = ctl & 0x7F
+        pos = 2
+        if ctl & 0x80:
+            if len(frame) < 3:
+                return []
+            self._window = 8 + (frame[2] >> 4)
+            self._len_bits = frame[2] & 0x0F
+            self._hist = bytearray()
+            pos = 3
+        elif self._next_seq is None or seq != self._next_seq:
+            self.frames_lost += 1
+            self._next_seq = None
+            return []
+        self._next_seq = (seq + 1) & 0x7F
+
+        data = self._inflate(frame, pos)
+        if data is None:
+            self.frames_lost += 1
+            self._next_seq = None
+            return []
+        return self._split(data)
+
+    def _inflate(self, frame: bytes, pos: int):
+        hist = self._hist
+        start = len(hist)
+        nbits = (len(frame) - pos) * 8
+        bitpos = 0
+        acc = int.from_bytes(frame[pos:], "big")
+        backref_bits = 1 + self._window + self._len_bits
+
+        def take(n):
+            nonlocal bitpos
+            v = (acc >> (nbits - bitpos - n)) & ((1 << n) - 1)
+            bitpos += n
+            return v
+
+        while nbits - bitpos >= 9:
+            if take(1):
+                hist.append(take(8))
+                continue
+            if nbits - bitpos < backref_bits - 1:
+                break   # zero padding
+            dist = take(self._window) + 1
+            length = take(self._len_bits) + _MIN_MATCH
+            if dist > len(hist):
+                return None
+            for _ in range(length):
+                hist.append(hist[-dist])
+
+        out = bytes(hist[start:])
+        # Keep only the window the encoder can still refer to
+        keep = 1 << self._window
+        if len(hist) > keep:
+            del hist[:len(hist) - keep]
+        return out
+
+    @staticmethod
+    def _split(data: bytes) -> list:
+        packets = []
+        i = 0
+        while i < len(data):
+            length = 0
+            shift = 0
+            while True:
+                if i >= len(data):
+                    return packets
+                b = data[i]
+                i += 1
+                length |= (b & 0x7F) << shift
+                shift += 7
+                if not b & 0x80:
+                    break
+            packets.append(bytes(data[i:i + length]))
+            i += length
+        return packets
@@ -5,7 +5,9 @@
  * Implements the adapter interface for Zephyr RTOS:
  *   - Queue-object type detection (Zephyr doesn't use FreeRTOS queue hacks)
  *   - Stack-usage calculation via k_thread_stack_space_get
+ *   - Painted-stack bounds for incremental watermark sampling
  *   - Mutex contention (Zephyr k_mutex owner field)
+ *   - Core id for CONFIG_SMP builds
  *
  * Also overrides Zephyr's CONFIG_TRACING_USER weak callbacks to emit
  * native ViewAlyzer task-switch events through the core engine.
@@ -51,13 +53,14 @@ static void va_zephyr_ensure_object_type(void *object,
     if (object == NULL)
         return;
 
-    if (_va_find_queue_object_id(object) == 0)
+    int idx = _va_find_queue_object_index(object);
+    if (idx < 0)
     {
         va_logQueueObjectCreateWithType(object, type_hint);
         return;
     }
 
-    if (_va_get_stored_queue_object_type(object) != expected_type)
+    if (queueObjectMap[idx].type != expected_type)
         va_updateQueueObjectType(object, type_hint);
 }
 
@@ -102,6 +105,26 @@ uint32_t va_adapter_calculate_stack_usage(void *taskHandle)
     return 0;
 }
 
+bool va_adapter_get_stack_region(void *taskHandle, VA_StackRegion_t *region)
+{
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO) && !defined(CONFIG_STACK_GROWS_UP)
+    /* CONFIG_INIT_STACKS paints thread stacks with 0xaa */
+    const struct k_thread *thread = (const struct k_thread *)taskHandle;
+    if (thread == NULL || thread->stack_info.start == 0 || thread->stack_info.size < sizeof(uint32_t))
+        return false;
+
+    region->base = (const uint32_t *)thread->stack_info.start;
+    region->words = (uint32_t)(thread->stack_info.size / sizeof(uint32_t));
+    region->fill = 0xaaaaaaaau;
+    region->unit_shift = 2; /* ulStackDepth is in bytes on Zephyr */
+    return true;
+#else
+    ARG_UNUSED(taskHandle);
+    ARG_UNUSED(region);
+    return false;
+#endif
+}
+
 uint32_t va_adapter_get_total_stack_size(void *taskHandle)
 {
     int idx = _va_find_task_index(taskHandle);
@@ -112,6 +135,17 @@ uint32_t va_adapter_get_total_stack_size(void *taskHandle)
     return 0;
 }
 
+#if VA_NUM_CORES > 1
+BUILD_ASSERT(VA_NUM_CORES == CONFIG_MP_MAX_NUM_CPUS,
+             "VA_NUM_CORES must match CONFIG_MP_MAX_NUM_CPUS");
+
+uint32_t va_adapter_get_core_id(void)
+{
+    /* Called with interrupts masked, so the thread can't migrate */
+    return (uint32_t)arch_curr_cpu()->id;
+}
+#endif
+
 /* ================================================================
  *  Adapter interface — mutex contention
  * ================================================================ */